@@ -4,6 +4,8 @@
 
 #include "ui3/VirusEditor.h"
 
+#include "../juceUiLib/resourceCache.h"
+
 #include "../synthLib/os.h"
 
 const std::vector<PluginEditorState::Skin> m_includedSkins =
@@ -76,6 +78,9 @@ void PluginEditorState::loadSkin(const Skin& _skin)
 
 	m_rootScale = 1.0f;
 
+	const auto* config = m_processor.getController().getConfig();
+	genericUI::ResourceCache::getInstance().setImageMemoryBudget(static_cast<size_t>(std::max(0, config->getIntValue("imageCacheMegabytes", 256))) * 1024 * 1024);
+
 	try
 	{
 		auto* editor = new genericVirusUI::VirusEditor(m_parameterBinding, m_processor, _skin.jsonFilename, _skin.folder, [this] { openMenu(); });
@@ -7,6 +7,7 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 
 #include "../synthLib/os.h"
+#include "../virusLib/presetUpgradeCache.h"
 
 //==============================================================================
 AudioPluginAudioProcessor::AudioPluginAudioProcessor() :
@@ -24,13 +25,19 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor() :
 	m_device(m_rom), m_plugin(&m_device)
 {
 	getController(); // init controller
-	m_clockTempoParam = getController().getParameterIndexByName(Virus::g_paramClockTempo);
+
+	const auto upgradeCacheFile = getController().getConfig()->getFile().getSiblingFile("presetUpgradeCache.bin");
+	upgradeCacheFile.getParentDirectory().createDirectory();
+	virusLib::PresetUpgradeCache::instance().setFilename(upgradeCacheFile.getFullPathName().toStdString());
 
 	const auto latencyBlocks = getController().getConfig()->getIntValue("latencyBlocks", static_cast<int>(getPlugin().getLatencyBlocks()));
 	setLatencyBlocks(latencyBlocks);
 }
 
-AudioPluginAudioProcessor::~AudioPluginAudioProcessor() = default;
+AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
+{
+	virusLib::PresetUpgradeCache::instance().save();
+}
 
 //==============================================================================
 const juce::String AudioPluginAudioProcessor::getName() const
@@ -199,7 +206,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 			if(status == synthLib::M_CONTROLCHANGE || status == synthLib::M_POLYPRESSURE)
 			{
 				// forward to UI to react to control input changes that should move knobs
-				getController().dispatchVirusOut(std::vector<synthLib::SMidiEvent>{ev});
+				getController().dispatchVirusOut(ev);
 			}
 		}
 
@@ -218,9 +225,9 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 
 		if(pos.bpm > 0) { // sync virus interal clock to host
 			const uint8_t bpmValue = juce::jmin(127, juce::jmax(0, (int)pos.bpm-63)); // clamp to virus range, 63-190
-			const auto clockParam = getController().getParameter(m_clockTempoParam, 0);
-			if (clockParam != nullptr && (int)clockParam->getValueObject().getValue() != bpmValue) {
-				clockParam->getValueObject().setValue(bpmValue);
+			if (m_hostClockTempo != bpmValue) {
+				m_hostClockTempo = bpmValue;
+				m_plugin.addParameterChange({virusLib::PAGE_B, 0, virusLib::CLOCK_TEMPO, bpmValue, 0});
 			}
 		}
 	}
@@ -236,15 +243,19 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 		getController().dispatchVirusOut(m_midiOut);
 	}
 
+    const auto lastSample = juce::jmax(0, buffer.getNumSamples() - 1);
+
     for (auto& e : m_midiOut)
     {
 	    if (e.source == synthLib::MidiEventSourceEditor)
 			continue;
 
+		const auto samplePosition = juce::jmin(static_cast<int>(e.offset), lastSample);
+
     	if (e.sysex.empty())
 		{
 			const juce::MidiMessage message(e.a, e.b, e.c, 0.0);
-			midiMessages.addEvent(message, 0);
+			midiMessages.addEvent(message, samplePosition);
 
 			// additionally send to the midi output we've selected in the editor
 			if (m_midiOutput)
@@ -253,7 +264,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 		else
 		{
 			const juce::MidiMessage message(&e.sysex[0], static_cast<int>(e.sysex.size()), 0.0);
-			midiMessages.addEvent(message, 0);
+			midiMessages.addEvent(message, samplePosition);
 
 			// additionally send to the midi output we've selected in the editor
 			if (m_midiOutput)
@@ -76,6 +76,14 @@ public:
     {
 	    return m_plugin;
     }
+    const virusLib::Device& getDevice() const
+    {
+	    return m_device;
+    }
+    uint8_t getHostClockTempo() const
+    {
+	    return m_hostClockTempo;
+    }
     void updateLatencySamples();
 
 	void setLatencyBlocks(uint32_t _blocks);
@@ -96,6 +104,6 @@ private:
 	virusLib::Device					m_device;
 	synthLib::Plugin					m_plugin;
 	std::vector<synthLib::SMidiEvent>	m_midiOut;
-    uint32_t							m_clockTempoParam = 0xffffffff;
+    std::atomic<uint8_t>				m_hostClockTempo{0xff};
     std::unique_ptr<PluginEditorState>  m_editorState;
 };
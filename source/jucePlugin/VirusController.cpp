@@ -1,10 +1,12 @@
 #include "VirusController.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "ParameterNames.h"
 #include "PluginProcessor.h"
 
+#include "../virusLib/microcontroller.h"
 #include "../virusLib/microcontrollerTypes.h"
 #include "../synthLib/os.h"
 
@@ -12,6 +14,10 @@
 
 using MessageType = virusLib::SysexMessageType;
 
+#ifndef VIRUS_HOST_PARAMETER_PARTS
+#define VIRUS_HOST_PARAMETER_PARTS 1
+#endif
+
 namespace Virus
 {
     constexpr const char* g_midiPacketNames[] =
@@ -38,7 +44,27 @@ namespace Virus
 
     Controller::Controller(AudioPluginAudioProcessor &p, unsigned char deviceId) : pluginLib::Controller(loadParameterDescriptions()), m_processor(p), m_deviceId(deviceId)
     {
-        registerParams(p);
+		// Parts above this count are not exposed to the host to keep its parameter list short. This is a build option and
+		// not a setting: the host addresses parameters by index, a layout that differs between machines would break projects
+		static_assert(VIRUS_HOST_PARAMETER_PARTS >= 1 && VIRUS_HOST_PARAMETER_PARTS <= 16, "VIRUS_HOST_PARAMETER_PARTS needs to be in range 1-16");
+
+        registerParams(p, VIRUS_HOST_PARAMETER_PARTS);
+
+		m_clockTempoParam = getParameterIndexByName(g_paramClockTempo);
+
+		for(uint32_t i=0; i<kNameLength; ++i)
+		{
+			m_presetParameterIndices.singleName[i] = getParameterIndexByName("SingleName" + std::to_string(i));
+			m_presetParameterIndices.multiName[i] = getParameterIndexByName("MultiName" + std::to_string(i));
+		}
+
+		m_presetParameterIndices.version = getParameterIndexByName("Version");
+		m_presetParameterIndices.category1 = getParameterIndexByName("Category1");
+		m_presetParameterIndices.category2 = getParameterIndexByName("Category2");
+		m_presetParameterIndices.unison = getParameterIndexByName("Unison Mode");
+		m_presetParameterIndices.transpose = getParameterIndexByName("Transpose");
+		m_presetParameterIndices.arpMode = getParameterIndexByName("Arp Mode");
+		m_presetParameterIndices.playMode = getParameterIndexByName(g_paramPlayMode);
 
 		juce::PropertiesFile::Options opts;
 		opts.applicationName = "DSP56300 Emulator";
@@ -62,12 +88,11 @@ namespace Virus
 				}
 			}));
 		}
-		requestTotal();
+		// preset banks are read from the device directly, only globals and edit buffers need to be requested
+		updateSinglePresets();
+		requestGlobal();
 		requestArrangement();
 
-    	for(uint8_t i=3; i<=8; ++i)
-			requestSingleBank(i);
-
     	startTimer(5);
 	}
 
@@ -186,29 +211,26 @@ namespace Virus
 
     std::string Controller::getSinglePresetName(const pluginLib::MidiPacket::ParamValues& _values) const
     {
-        return getPresetName("SingleName", _values);
+        return getPresetName(m_presetParameterIndices.singleName, _values);
     }
 
     std::string Controller::getMultiPresetName(const pluginLib::MidiPacket::ParamValues& _values) const
     {
-        return getPresetName("MultiName", _values);
+        return getPresetName(m_presetParameterIndices.multiName, _values);
     }
 
-    std::string Controller::getPresetName(const std::string& _paramNamePrefix, const pluginLib::MidiPacket::ParamValues& _values) const
+    std::string Controller::getPresetName(const std::array<uint32_t, kNameLength>& _indices, const pluginLib::MidiPacket::ParamValues& _values)
     {
         std::string name;
-        for(uint32_t i=0; i<kNameLength; ++i)
-        {
-	        const std::string paramName = _paramNamePrefix + std::to_string(i);
-            const auto idx = getParameterIndexByName(paramName);
-            if(idx == InvalidParameterIndex)
-                break;
+        name.reserve(kNameLength);
 
-            const auto it = _values.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idx));
-            if(it == _values.end())
+        for (const auto idx : _indices)
+        {
+            const auto* v = _values.find(pluginLib::MidiPacket::AnyPart, idx);
+            if(!v)
                 break;
 
-            name += static_cast<char>(it->second);
+            name += static_cast<char>(*v);
         }
         return name;
     }
@@ -217,8 +239,7 @@ namespace Virus
 	{
 		for (int i=0; i<kNameLength; i++)
 		{
-	        const std::string paramName = "SingleName" + std::to_string(i);
-            const auto idx = getParameterIndexByName(paramName);
+            const auto idx = m_presetParameterIndices.singleName[i];
             if(idx == InvalidParameterIndex)
                 break;
 
@@ -235,8 +256,7 @@ namespace Virus
 
 	bool Controller::isMultiMode() const
 	{
-        const auto paramIdx = getParameterIndexByName(g_paramPlayMode);
-		const auto& value = getParameter(paramIdx)->getValueObject();
+		const auto& value = getParameter(m_presetParameterIndices.playMode)->getValueObject();
 		return value.getValue();
 	}
 
@@ -245,8 +265,7 @@ namespace Virus
         std::string name;
 		for (int i=0; i<kNameLength; i++)
 		{
-	        const std::string paramName = "SingleName" + std::to_string(i);
-            const auto idx = getParameterIndexByName(paramName);
+            const auto idx = m_presetParameterIndices.singleName[i];
             if(idx == InvalidParameterIndex)
                 break;
 
@@ -470,24 +489,12 @@ namespace Virus
 		}
     }
 
-	void Controller::parseControllerDump(synthLib::SMidiEvent &m)
+	void Controller::parseControllerDump(const uint8_t _page, const uint8_t _part, const uint8_t _index, const uint8_t _value)
 	{
-		const uint8_t status = m.a & 0xf0;
-    	const uint8_t part = m.a & 0x0f;
-
-		uint8_t page;
-
-		if (status == synthLib::M_CONTROLCHANGE)
-			page = virusLib::PAGE_A;
-		else if (status == synthLib::M_POLYPRESSURE)
-			page = virusLib::PAGE_B;
-		else
-			return;
-
-		DBG(juce::String::formatted("Set part: %d bank: %s param: %d  value: %d", part, page == 0 ? "A" : "B", m.b, m.c));
-		const auto& params = findSynthParam(part, page, m.b);
+		DBG(juce::String::formatted("Set part: %d bank: %s param: %d  value: %d", _part, _page == virusLib::PAGE_A ? "A" : "B", _index, _value));
+		const auto& params = findSynthParam(_part, _page, _index);
 		for (const auto & p : params)
-			p->setValueFromSynth(m.c, true, pluginLib::Parameter::ChangedBy::ControlChange);
+			p->setValueFromSynth(_value, true, pluginLib::Parameter::ChangedBy::ControlChange);
 	}
 
     void Controller::printMessage(const SysEx &msg)
@@ -514,7 +521,7 @@ namespace Virus
 
     void Controller::onStateLoaded() const
     {
-		requestTotal();
+		requestGlobal();
 		requestArrangement();
 	}
 
@@ -551,6 +558,11 @@ namespace Virus
         return sendSysEx(MidiPacketType::RequestTotal);
     }
 
+    bool Controller::requestGlobal() const
+    {
+        return sendSysEx(MidiPacketType::RequestGlobal);
+    }
+
     bool Controller::requestArrangement() const
     {
         return sendSysEx(MidiPacketType::RequestArrangement);
@@ -577,27 +589,143 @@ namespace Virus
 
     void Controller::timerCallback()
     {
-        const juce::ScopedLock sl(m_eventQueueLock);
-        for (auto msg : m_virusOut)
+        while (m_virusOut.pop(m_virusOutEvent))
         {
-            if (msg.sysex.empty())
-            {
-                // no sysex
-				parseControllerDump(msg);
-			}
-            else
-			{
-				parseMessage(msg.sysex);               
-			}
+	        // controller values that arrived before this sysex need to be applied first
+	        applyPendingControllerValues(m_virusOutRead++);
+			parseMessage(m_virusOutEvent.sysex);
+        }
+
+        // values that arrived after a sysex that has not been popped yet stay pending until the next tick
+        applyPendingControllerValues(m_virusOutRead);
+
+        updateSinglePresets();
+
+        if(const auto dropped = m_droppedVirusOut.exchange(0))
+            LOG("Controller: " << dropped << " messages from the device were dropped, queue is full");
+
+		// host tempo is sent to the device by the audio thread, reflect it in the UI
+		const auto hostClockTempo = m_processor.getHostClockTempo();
+
+		if(hostClockTempo <= 127)
+		{
+			auto* clockParam = getParameter(m_clockTempoParam, 0);
+			if(clockParam)
+				clockParam->setValueFromSynth(hostClockTempo, false, pluginLib::Parameter::ChangedBy::HostAutomation);
+		}
+    }
+
+    void Controller::applyPendingControllerValues(const uint16_t _sysexSequence)
+    {
+        if(!m_hasPendingControllerValues.exchange(false, std::memory_order_acquire))
+	        return;
+
+        bool remaining = false;
+
+        for(uint32_t i=0; i<m_pendingControllerValues.size(); ++i)
+        {
+	        auto v = m_pendingControllerValues[i].load(std::memory_order_relaxed);
+
+	        if(!(v & kPendingValueFlag))
+		        continue;
+
+	        // skip values that arrived after the sysex that is parsed next
+	        if(static_cast<int16_t>(static_cast<uint16_t>(v >> 16) - _sysexSequence) > 0)
+	        {
+		        remaining = true;
+		        continue;
+	        }
+
+	        // if the audio thread wrote a newer value in the meantime, that one stays pending
+	        if(!m_pendingControllerValues[i].compare_exchange_strong(v, 0, std::memory_order_relaxed))
+		        continue;
+
+	        const auto page = static_cast<uint8_t>((i >> 11) ? virusLib::PAGE_B : virusLib::PAGE_A);
+	        const auto part = static_cast<uint8_t>((i >> 7) & 0xf);
+	        const auto index = static_cast<uint8_t>(i & 0x7f);
+
+	        parseControllerDump(page, part, index, static_cast<uint8_t>(v & 0x7f));
+        }
+
+        if(remaining)
+	        m_hasPendingControllerValues.store(true, std::memory_order_relaxed);
+    }
+
+    void Controller::updateSinglePresets()
+    {
+        const auto& device = m_processor.getDevice();
+
+        const auto generation = device.getPresetGeneration();
+
+        if(generation == m_presetGeneration)
+            return;
+
+        m_presetGeneration = generation;
+
+        const auto bankCount = std::min(static_cast<size_t>(device.getSingleBankCount()), m_singles.size());
+
+        std::vector<virusLib::ROMFile::TPreset> presets;
+        std::vector<uint32_t> generations;
+
+        for(uint8_t b=0; b<bankCount; ++b)
+        {
+	        // banks that have not been written to since the last update are skipped, ROM banks are never written
+	        if(device.getSingleBankGeneration(b) == m_singleBankGenerations[b])
+		        continue;
+
+	        // copy the whole bank at once instead of locking the catalogue per preset
+	        if(!device.getSingleBank(b, presets, generations, m_singleBankGenerations[b]))
+		        continue;
+
+            const auto bank = virusLib::fromArrayIndex(b);
+
+	        for(uint8_t p=0; p<m_singles[b].size() && p<presets.size(); ++p)
+	        {
+		        if(generations[p] == m_singleGenerations[b][p])
+			        continue;
+
+		        m_singleGenerations[b][p] = generations[p];
+
+		        const auto& preset = presets[p];
+
+		        auto& patch = m_singles[b][p];
+
+		        patch.bankNumber = bank;
+		        patch.progNumber = p;
+		        patch.name = virusLib::ROMFile::getSingleName(preset);
+		        patch.data = virusLib::Microcontroller::createPresetDump(virusLib::DUMP_SINGLE, bank, p, preset);
+	        }
         }
-        m_virusOut.clear();
     }
 
     void Controller::dispatchVirusOut(const std::vector<synthLib::SMidiEvent> &newData)
     {
-        const juce::ScopedLock sl(m_eventQueueLock);
+        for (const auto& ev : newData)
+	        dispatchVirusOut(ev);
+    }
 
-        m_virusOut.insert(m_virusOut.end(), newData.begin(), newData.end());
+    void Controller::dispatchVirusOut(const synthLib::SMidiEvent& _ev)
+    {
+        if(!_ev.sysex.empty())
+        {
+	        if(m_virusOut.push(_ev))
+		        ++m_virusOutWritten;
+	        else
+		        ++m_droppedVirusOut;
+	        return;
+        }
+
+		const uint8_t status = _ev.a & 0xf0;
+
+        // page A parameters are sent as control changes, page B parameters as poly pressure, anything else is ignored by the UI
+		if (status != synthLib::M_CONTROLCHANGE && status != synthLib::M_POLYPRESSURE)
+            return;
+
+        const uint32_t page = status == synthLib::M_POLYPRESSURE ? 1 : 0;
+        const uint32_t idx = (page << 11) | ((_ev.a & 0x0f) << 7) | (_ev.b & 0x7f);
+
+        m_pendingControllerValues[idx].store((static_cast<uint32_t>(m_virusOutWritten) << 16) | kPendingValueFlag | (_ev.c & 0x7f), std::memory_order_relaxed);
+        m_hasPendingControllerValues.store(true, std::memory_order_release);
     }
 
     void Controller::sendParameterChange(const pluginLib::Parameter& _parameter, uint8_t _value)
@@ -609,14 +737,9 @@ namespace Virus
 
     bool Controller::sendParameterChange(uint8_t _page, uint8_t _part, uint8_t _index, uint8_t _value) const
     {
-        std::map<pluginLib::MidiDataType, uint8_t> data;
-
-        data.insert(std::make_pair(pluginLib::MidiDataType::Page, _page));
-        data.insert(std::make_pair(pluginLib::MidiDataType::Part, _part));
-        data.insert(std::make_pair(pluginLib::MidiDataType::ParameterIndex, _index));
-        data.insert(std::make_pair(pluginLib::MidiDataType::ParameterValue, _value));
-
-    	return sendSysEx(MidiPacketType::ParameterChange, data);
+        // sent to the device directly, sysex is only used for external MIDI
+        m_processor.getPlugin().addParameterChange({_page, _part, _index, _value, 0});
+        return true;
     }
 
     std::vector<uint8_t> Controller::createSingleDump(uint8_t _part, uint8_t _bank, uint8_t _program)
@@ -6,6 +6,7 @@
 #include "../virusLib/microcontrollerTypes.h"
 
 #include "../synthLib/plugin.h"
+#include "../synthLib/spscQueue.h"
 
 class AudioPluginAudioProcessor;
 
@@ -33,6 +34,20 @@ namespace Virus
 
     	static constexpr auto kNameLength = 10;
 
+		// parameter indices resolved once, used to inspect parsed presets without looking up parameters by name
+		struct PresetParameterIndices
+		{
+			std::array<uint32_t, kNameLength> singleName{};
+			std::array<uint32_t, kNameLength> multiName{};
+			uint32_t version = InvalidParameterIndex;
+			uint32_t category1 = InvalidParameterIndex;
+			uint32_t category2 = InvalidParameterIndex;
+			uint32_t unison = InvalidParameterIndex;
+			uint32_t transpose = InvalidParameterIndex;
+			uint32_t arpMode = InvalidParameterIndex;
+			uint32_t playMode = InvalidParameterIndex;
+		};
+
 		enum class MidiPacketType
 		{
 			RequestSingle,
@@ -69,6 +84,7 @@ namespace Virus
 
         // this is called by the plug-in on audio thread!
         void dispatchVirusOut(const std::vector<synthLib::SMidiEvent> &);
+        void dispatchVirusOut(const synthLib::SMidiEvent&);
 
         std::vector<uint8_t> createSingleDump(uint8_t _part, uint8_t _bank, uint8_t _program);
         std::vector<uint8_t> createSingleDump(uint8_t _bank, uint8_t _program, const pluginLib::MidiPacket::ParamValues& _paramValues);
@@ -84,7 +100,9 @@ namespace Virus
         juce::StringArray getSinglePresetNames(virusLib::BankNumber bank) const;
         std::string getSinglePresetName(const pluginLib::MidiPacket::ParamValues& _values) const;
         std::string getMultiPresetName(const pluginLib::MidiPacket::ParamValues& _values) const;
-        std::string getPresetName(const std::string& _paramNamePrefix, const pluginLib::MidiPacket::ParamValues& _values) const;
+        static std::string getPresetName(const std::array<uint32_t, kNameLength>& _indices, const pluginLib::MidiPacket::ParamValues& _values);
+
+		const PresetParameterIndices& getPresetParameterIndices() const { return m_presetParameterIndices; }
 
     	const Singles& getSinglePresets() const
         {
@@ -135,6 +153,7 @@ namespace Virus
     	bool requestSingleBank(uint8_t _bank) const;
 
     	bool requestTotal() const;
+    	bool requestGlobal() const;
     	bool requestArrangement() const;
         
 		void sendParameterChange(const pluginLib::Parameter& _parameter, uint8_t _value) override;
@@ -152,7 +171,13 @@ namespace Virus
 
 		void timerCallback() override;
 
+		// fetches the single presets whose generation changed from the device preset catalogue
+		void updateSinglePresets();
+
         Singles m_singles;
+        std::array<std::array<uint32_t, 128>, 8> m_singleGenerations{};
+        std::array<uint32_t, 8> m_singleBankGenerations{};
+        uint32_t m_presetGeneration = 0;
         SinglePatch m_singleEditBuffer;                     // single mode
         std::array<SinglePatch, 16> m_singleEditBuffers;    // multi mode
 
@@ -164,16 +189,30 @@ namespace Virus
     	void parseMulti(const SysEx& _msg, const pluginLib::MidiPacket::Data& _data, const pluginLib::MidiPacket::ParamValues& _parameterValues);
 
         void parseParamChange(const pluginLib::MidiPacket::Data& _data);
-        void parseControllerDump(synthLib::SMidiEvent &);
+        void parseControllerDump(uint8_t _page, uint8_t _part, uint8_t _index, uint8_t _value);
+        void applyPendingControllerValues(uint16_t _sysexSequence);
 
         AudioPluginAudioProcessor& m_processor;
-        juce::CriticalSection m_eventQueueLock;
-        std::vector<synthLib::SMidiEvent> m_virusOut;
+
+        // audio thread => message thread. Sysex is queued, controller values are coalesced, only the last value of
+        // each page A/B parameter per part is applied by the UI. Each value is tagged with the number of sysex messages
+        // queued before it so that it is applied in order with the sysex, a dump must not overwrite a newer value
+        static constexpr uint32_t kPendingValueFlag = 0x8000;
+        synthLib::SpscQueue<synthLib::SMidiEvent, 4096> m_virusOut;
+        std::array<std::atomic<uint32_t>, 2 * 16 * 128> m_pendingControllerValues{};
+        uint16_t m_virusOutWritten = 0;	// audio thread
+        uint16_t m_virusOutRead = 0;	// message thread
+        std::atomic<bool> m_hasPendingControllerValues = false;
+        std::atomic<uint32_t> m_droppedVirusOut = 0;
+        synthLib::SMidiEvent m_virusOutEvent;
+
         unsigned char m_deviceId;
         virusLib::BankNumber m_currentBank[16]{};
         uint8_t m_currentProgram[16]{};
         PresetSource m_currentPresetSource[16]{PresetSource::Unknown};
 		uint8_t m_currentPart = 0;
 		juce::PropertiesFile *m_config;
+		uint32_t m_clockTempoParam = 0xffffffff;
+		PresetParameterIndices m_presetParameterIndices;
     };
 }; // namespace Virus
@@ -90,7 +90,7 @@ void VirusParameterBinding::bind(juce::ComboBox& _combo, const uint32_t _param,
 		if((id - 1) == current)
 			return;
 
-		if(v->getDescription().isPublic)
+		if(v->isRegisteredWithHost())
 		{
 			v->beginChangeGesture();
 			v->setValueNotifyingHost(v->convertTo0to1(static_cast<float>(id - 1)));
@@ -21,9 +21,9 @@ public:
 	}
 	pluginLib::Parameter *m_param;
 	juce::Slider* m_slider;
-	void mouseDown(const juce::MouseEvent &event) override { m_param->beginChangeGesture(); }
-	void mouseUp(const juce::MouseEvent &event) override { m_param->endChangeGesture(); }
-	void mouseDrag(const juce::MouseEvent &event) override { m_param->setValueNotifyingHost(m_param->convertTo0to1(static_cast<float>(m_slider->getValue()))); }
+	void mouseDown(const juce::MouseEvent &event) override { if(m_param->isRegisteredWithHost()) m_param->beginChangeGesture(); }
+	void mouseUp(const juce::MouseEvent &event) override { if(m_param->isRegisteredWithHost()) m_param->endChangeGesture(); }
+	void mouseDrag(const juce::MouseEvent &event) override { if(m_param->isRegisteredWithHost()) m_param->setValueNotifyingHost(m_param->convertTo0to1(static_cast<float>(m_slider->getValue()))); }
 };
 
 class VirusParameterBinding final : juce::MouseListener
@@ -1,14 +1,18 @@
 #include "PatchBrowser.h"
 
+#include "PatchIndex.h"
 #include "VirusEditor.h"
 
 #include "../../virusLib/microcontrollerTypes.h"
 #include "../../virusLib/microcontroller.h"
 
 #include "../VirusController.h"
-#include "juce_cryptography/hashing/juce_MD5.h"
 
+#include "../../synthLib/hash.h"
 #include "../../synthLib/midiToSysex.h"
+#include "../../synthLib/sysexIterator.h"
+
+#include "dsp56kEmu/logging.h"
 
 using namespace juce;
 
@@ -16,6 +20,9 @@ const juce::Array<juce::String> ModelList = {"A","B","C","TI"};
 
 namespace genericVirusUI
 {
+	// upper bound of the size of a single dump, used to read a single patch from a bank file
+	constexpr size_t g_maxSingleDumpSize = 1024;
+
 	virusLib::PresetVersion guessVersion(const uint8_t v)
 	{
 		return virusLib::Microcontroller::getPresetVersion(v);
@@ -30,6 +37,8 @@ namespace genericVirusUI
 		m_patchList("Patch Browser"),
 		m_properties(m_controller.getConfig())
 	{
+		PatchIndex::instance().setFilename(m_properties->getFile().getSiblingFile("patchIndex.bin").getFullPathName().toStdString());
+
 		const auto bankDir = m_properties->getValue("virus_bank_dir", "");
 
 		if (bankDir.isNotEmpty() && File(bankDir).isDirectory())
@@ -106,6 +115,10 @@ namespace genericVirusUI
 
 	PatchBrowser::~PatchBrowser()
 	{
+		cancelIndexing();
+
+		PatchIndex::instance().save();
+
 		if(s_lastPatchBrowser == this)
 			s_lastPatchBrowser = nullptr;
 	}
@@ -127,48 +140,64 @@ namespace genericVirusUI
 
 	void PatchBrowser::selectionChanged() {}
 
-	uint32_t PatchBrowser::load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const std::vector<std::vector<uint8_t>>& _packets)
+	uint32_t PatchBrowser::load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const uint8_t* _data, const size_t _size)
 	{
 		uint32_t count = 0;
-		for (const auto& packet : _packets)
+		uint32_t checksumErrors = 0;
+
+		synthLib::SysexIterator it(_data, _size, &isValidSingleDump);
+		synthLib::SysexView message;
+
+		while(it.next(message))
 		{
-			if (load(_controller, _result, _dedupeChecksums, packet))
+			const auto prevSize = _result.size();
+
+			if (load(_controller, _result, _dedupeChecksums, message))
+			{
+				if(_result.size() > prevSize)
+				{
+					_result.back().fileOffset = static_cast<uint32_t>(message.data - _data);
+
+					if(!hasValidChecksum(message))
+						++checksumErrors;
+				}
 				++count;
+			}
 		}
+
+		if(checksumErrors)
+			LOG("Loaded " << checksumErrors << " single dumps with invalid checksum");
+
 		return count;
 	}
 
-	bool PatchBrowser::load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const std::vector<uint8_t>& _data)
+	bool PatchBrowser::load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const synthLib::SysexView& _message)
 	{
-		if (_data.size() < 267)
+		if (_message.size < 267)
 			return false;
 
+		const auto hash = createPatchHash(_message);
+
+		if (_dedupeChecksums && _dedupeChecksums->find(hash) != _dedupeChecksums->end())
+			return true;
+
 		Patch patch;
-		patch.sysex = _data;
+		patch.sysex = _message.toVector();
+		patch.hash = hash;
 		if(!initializePatch(_controller, patch))
 			return false;
 
 		patch.progNumber = static_cast<int>(_result.size());
 
-		if (!_dedupeChecksums)
-		{
-			_result.push_back(patch);
-		}
-		else
-		{
-			const auto md5 = std::string(MD5(&_data.front() + 9 + 17, 256 - 17 - 3).toHexString().toRawUTF8());
+		if (_dedupeChecksums)
+			_dedupeChecksums->insert(hash);
 
-			if (_dedupeChecksums->find(md5) == _dedupeChecksums->end())
-			{
-				_dedupeChecksums->insert(md5);
-				_result.push_back(patch);
-			}
-		}
+		_result.push_back(std::move(patch));
 
 		return true;
 	}
 
-	uint32_t PatchBrowser::loadBankFile(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const File& file)
+	uint32_t PatchBrowser::loadBankFile(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const File& file)
 	{
 		const auto ext = file.getFileExtension().toLowerCase();
 		const auto path = file.getParentDirectory().getFullPathName();
@@ -180,14 +209,7 @@ namespace genericVirusUI
 			if (!file.loadFileAsData(data))
 				return 0;
 
-			std::vector<uint8_t> d;
-			d.resize(data.getSize());
-			memcpy(&d[0], data.getData(), data.getSize());
-
-			std::vector<std::vector<uint8_t>> packets;
-			synthLib::MidiToSysex::splitMultipleSysex(packets, d);
-
-			return load(_controller, _result, _dedupeChecksums, packets);
+			return load(_controller, _result, _dedupeChecksums, static_cast<const uint8_t*>(data.getData()), data.getSize());
 		}
 
 		if (ext == ".mid" || ext == ".midi")
@@ -199,10 +221,7 @@ namespace genericVirusUI
 			if (data.empty())
 				return 0;
 
-			std::vector<std::vector<uint8_t>> packets;
-			synthLib::MidiToSysex::splitMultipleSysex(packets, data);
-
-			return load(_controller, _result, _dedupeChecksums, packets);
+			return load(_controller, _result, _dedupeChecksums, &data.front(), data.size());
 		}
 
 		return 0;
@@ -227,16 +246,7 @@ namespace genericVirusUI
 			auto p = PopupMenu();
 			p.addItem("Add directory contents to patch list", [this, file]()
 				{
-					m_patches.clear();
-					m_checksums.clear();
-					std::set<std::string> dedupeChecksums;
-
-					std::vector<Patch> patches;
-
-					for (const auto& f : RangedDirectoryIterator(file, false, "*.syx;*.mid;*.midi", File::findFiles))
-						loadBankFile(m_controller, patches, &dedupeChecksums, f.getFile());
-
-					fillPatchList(patches);
+					indexDirectory(file);
 				});
 			p.showMenuAsync(PopupMenu::Options());
 
@@ -313,7 +323,19 @@ namespace genericVirusUI
 		// re-pack single, force to edit buffer
 		const auto program = m_controller.isMultiMode() ? m_controller.getCurrentPart() : static_cast<uint8_t>(virusLib::ProgramType::SINGLE);
 
-		const auto& patch = m_filteredPatches[idx];
+		auto patch = m_filteredPatches[idx];
+
+		if(patch.sysex.empty())
+		{
+			if(!loadSysex(patch))
+				return;
+
+			// keep the dump, selecting the patch again does not need to read the file again
+			m_filteredPatches.getReference(idx).sysex = patch.sysex;
+
+			if(patch.progNumber < m_patches.size() && m_patches[patch.progNumber].hash == patch.hash)
+				m_patches.getReference(patch.progNumber).sysex = patch.sysex;
+		}
 
 		const auto msg = m_controller.modifySingleDump(patch.sysex, virusLib::BankNumber::EditBuffer, program, true, true);
 
@@ -427,6 +449,8 @@ namespace genericVirusUI
 
 	void PatchBrowser::fillPatchList(const std::vector<Patch>& _patches)
 	{
+		cancelIndexing();
+
 		m_patches.clear();
 
 		for (const auto& patch : _patches)
@@ -492,6 +516,150 @@ namespace genericVirusUI
 		return true;
 	}
 
+	void PatchBrowser::indexDirectory(const juce::File& _directory)
+	{
+		fillPatchList({});
+
+		m_checksums.clear();
+		m_indexedChecksums.clear();
+
+		m_indexer.reset(new PatchIndexer(m_controller, _directory));
+
+		startTimer(100);
+	}
+
+	void PatchBrowser::cancelIndexing()
+	{
+		stopTimer();
+		m_indexer.reset();
+	}
+
+	void PatchBrowser::timerCallback()
+	{
+		if(!m_indexer)
+		{
+			stopTimer();
+			return;
+		}
+
+		std::vector<PatchIndex::FileEntry> entries;
+
+		const auto running = m_indexer->poll(entries);
+
+		bool changed = false;
+
+		for (const auto& entry : entries)
+		{
+			const juce::File file(entry.path);
+
+			for (const auto& p : entry.patches)
+			{
+				if(m_indexedChecksums.find(p.hash) != m_indexedChecksums.end())
+					continue;
+
+				m_indexedChecksums.insert(p.hash);
+
+				Patch patch;
+				patch.progNumber = m_patches.size();
+				patch.name = juce::String(p.name);
+				patch.category1 = p.category1;
+				patch.category2 = p.category2;
+				patch.model = static_cast<virusLib::PresetVersion>(p.model);
+				patch.unison = p.unison;
+				patch.transpose = p.transpose;
+				patch.arpMode = p.arpMode;
+				patch.hash = p.hash;
+				patch.file = file;
+				patch.fileOffset = p.fileOffset;
+
+				m_patches.add(patch);
+				changed = true;
+			}
+		}
+
+		if(changed)
+		{
+			// do not send the previously selected patch to the device every time the list grows
+			m_sendOnSelect = false;
+			refreshPatchList();
+			m_sendOnSelect = true;
+		}
+
+		if(!running)
+		{
+			cancelIndexing();
+			PatchIndex::instance().save();
+		}
+	}
+
+	bool PatchBrowser::loadSysex(Patch& _patch)
+	{
+		std::vector<uint8_t> data;
+
+		const auto ext = _patch.file.getFileExtension().toLowerCase();
+
+		if (ext == ".syx")
+		{
+			// read the dump of this patch only
+			FileInputStream stream(_patch.file);
+
+			if (!stream.openedOk() || !stream.setPosition(_patch.fileOffset))
+				return false;
+
+			data.resize(g_maxSingleDumpSize);
+
+			const auto size = stream.read(&data.front(), static_cast<int>(data.size()));
+
+			if (size <= 0)
+				return false;
+
+			data.resize(static_cast<size_t>(size));
+		}
+		else
+		{
+			synthLib::MidiToSysex::readFile(data, _patch.file.getFullPathName().getCharPointer());
+
+			if (_patch.fileOffset >= data.size())
+				return false;
+
+			data.erase(data.begin(), data.begin() + _patch.fileOffset);
+		}
+
+		synthLib::SysexIterator it(data, &isValidSingleDump);
+		synthLib::SysexView message;
+
+		// the file may have been modified since it has been indexed
+		if(!it.next(message) || message.data != &data.front() || createPatchHash(message) != _patch.hash)
+			return false;
+
+		_patch.sysex = message.toVector();
+		return true;
+	}
+
+	bool PatchBrowser::isValidSingleDump(const synthLib::SysexView& _message)
+	{
+		// dumps with a wrong checksum are accepted, the controller ignores checksum errors when parsing them, too
+		return _message.size >= 267;
+	}
+
+	bool PatchBrowser::hasValidChecksum(const synthLib::SysexView& _message)
+	{
+		// checksum for ABC models comes after 256 bytes of preset data, other dumps are not checked
+		if(_message.size != 267)
+			return true;
+
+		uint8_t cs = 0;
+		for(size_t i=5; i<265; ++i)
+			cs += _message[i];
+
+		return (cs & 0x7f) == _message[265];
+	}
+
+	uint64_t PatchBrowser::createPatchHash(const synthLib::SysexView& _message)
+	{
+		return synthLib::hash(_message.data + 9 + 17, 256 - 17 - 3);
+	}
+
 	bool PatchBrowser::initializePatch(const Virus::Controller& _controller, Patch& _patch)
 	{
 		const auto& c = _controller;
@@ -502,24 +670,20 @@ namespace genericVirusUI
 		if(!c.parseSingle(data, parameterValues, _patch.sysex))
 			return false;
 
-		const auto idxVersion = c.getParameterIndexByName("Version");
-		const auto idxCategory1 = c.getParameterIndexByName("Category1");
-		const auto idxCategory2 = c.getParameterIndexByName("Category2");
-		const auto idxUnison = c.getParameterIndexByName("Unison Mode");
-		const auto idxTranspose = c.getParameterIndexByName("Transpose");
-		const auto idxArpMode = c.getParameterIndexByName("Arp Mode");
+		const auto& indices = c.getPresetParameterIndices();
+		constexpr auto anyPart = pluginLib::MidiPacket::AnyPart;
 
 		_patch.name = c.getSinglePresetName(parameterValues);
-		_patch.model = guessVersion(parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxVersion))->second);
-		_patch.unison = parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxUnison))->second;
-		_patch.transpose = parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxTranspose))->second;
-		_patch.arpMode = parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxArpMode))->second;
+		_patch.model = guessVersion(parameterValues.get(anyPart, indices.version));
+		_patch.unison = parameterValues.get(anyPart, indices.unison);
+		_patch.transpose = parameterValues.get(anyPart, indices.transpose);
+		_patch.arpMode = parameterValues.get(anyPart, indices.arpMode);
 
-		const auto category1 = parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxCategory1))->second;
-		const auto category2 = parameterValues.find(std::make_pair(pluginLib::MidiPacket::AnyPart, idxCategory2))->second;
+		const auto category1 = parameterValues.get(anyPart, indices.category1);
+		const auto category2 = parameterValues.get(anyPart, indices.category2);
 
-		const auto* paramCategory1 = c.getParameter(idxCategory1, 0);
-		const auto* paramCategory2 = c.getParameter(idxCategory2, 0);
+		const auto* paramCategory1 = c.getParameter(indices.category1, 0);
+		const auto* paramCategory2 = c.getParameter(indices.category2, 0);
 		
 		_patch.category1 = paramCategory1->getDescription().valueList.valueToText(category1);
 		_patch.category2 = paramCategory2->getDescription().valueList.valueToText(category2);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <set>
 
 #include <juce_audio_processors/juce_audio_processors.h>
@@ -14,9 +15,15 @@ namespace virusLib
 	enum PresetVersion : uint8_t;
 }
 
+namespace synthLib
+{
+	struct SysexView;
+}
+
 namespace genericVirusUI
 {
 	class VirusEditor;
+	class PatchIndexer;
 
 	struct Patch
 	{
@@ -29,23 +36,29 @@ namespace genericVirusUI
 	    uint8_t unison = 0;
 	    uint8_t transpose = 0;
 	    uint8_t arpMode = 0;
+	    uint64_t hash = 0;
+	    juce::File file;	// set if the sysex has not been loaded yet, it is read from this file when the patch is selected
+	    uint32_t fileOffset = 0;	// position of the dump in the sysex data of the file it has been loaded from
 	};
 
-	class PatchBrowser : public juce::FileBrowserListener, juce::TableListBoxModel
+	class PatchBrowser : public juce::FileBrowserListener, juce::TableListBoxModel, juce::Timer
 	{
 	public:
 		explicit PatchBrowser(const VirusEditor& _editor);
 		~PatchBrowser() override;
 
-		static uint32_t load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const std::vector<std::vector<uint8_t>>& _packets);
-		static bool load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const std::vector<uint8_t>& _data);
-		static uint32_t loadBankFile(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<std::string>* _dedupeChecksums, const juce::File& file);
+		static uint32_t load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const uint8_t* _data, size_t _size);
+		static bool load(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const synthLib::SysexView& _message);
+		static uint32_t loadBankFile(const Virus::Controller& _controller, std::vector<Patch>& _result, std::set<uint64_t>* _dedupeChecksums, const juce::File& file);
 
 		bool selectPrevPreset();
 		bool selectNextPreset();
 
 	private:
 		static bool initializePatch(const Virus::Controller& _controller, Patch& _patch);
+		static bool isValidSingleDump(const synthLib::SysexView& _message);
+		static bool hasValidChecksum(const synthLib::SysexView& _message);
+		static uint64_t createPatchHash(const synthLib::SysexView& _message);
 
 	    juce::FileBrowserComponent& getBankList() {return m_bankList; }
 	    juce::TableListBox& getPatchList() {return m_patchList; }
@@ -73,6 +86,11 @@ namespace genericVirusUI
 		void fillPatchList(const std::vector<Patch>& _patches);
 		void refreshPatchList();
 
+		void indexDirectory(const juce::File& _directory);
+		void cancelIndexing();
+		void timerCallback() override;
+		static bool loadSysex(Patch& _patch);
+
 		bool selectPrevNextPreset(int _dir);
 
 		class PatchBrowserSorter;
@@ -100,6 +118,8 @@ namespace genericVirusUI
 	    juce::PropertiesFile *m_properties;
 		juce::ComboBox* m_romBankSelect;
 	    juce::HashMap<juce::String, bool> m_checksums;
+		std::unique_ptr<PatchIndexer> m_indexer;
+		std::set<uint64_t> m_indexedChecksums;
 		bool m_sendOnSelect = true;
     };
 }
@@ -0,0 +1,284 @@
+#include "PatchIndex.h"
+
+#include <fstream>
+
+#include "PatchBrowser.h"
+
+#include "dsp56kEmu/logging.h"
+
+namespace genericVirusUI
+{
+	constexpr uint32_t g_indexFileMagic = 0x58495056;	// 'VPIX'
+	constexpr uint32_t g_indexFileVersion = 2;
+	constexpr size_t g_maxEntries = 65536;
+	constexpr uint32_t g_maxIndexerThreads = 4;
+
+	PatchIndex& PatchIndex::instance()
+	{
+		static PatchIndex index;
+		return index;
+	}
+
+	bool PatchIndex::find(FileEntry& _entry, const juce::File& _file) const
+	{
+		const auto path = _file.getFullPathName().toStdString();
+
+		std::lock_guard lock(m_mutex);
+
+		const auto it = m_entries.find(path);
+
+		if(it == m_entries.end())
+			return false;
+
+		const auto& entry = it->second;
+
+		if(entry.modificationTime != _file.getLastModificationTime().toMilliseconds() || entry.size != _file.getSize())
+			return false;
+
+		_entry = entry;
+		return true;
+	}
+
+	void PatchIndex::add(const FileEntry& _entry)
+	{
+		std::lock_guard lock(m_mutex);
+
+		const auto it = m_entries.find(_entry.path);
+
+		if(it != m_entries.end())
+			it->second = _entry;
+		else if(m_entries.size() < g_maxEntries)
+			m_entries.insert(std::make_pair(_entry.path, _entry));
+		else
+			return;
+
+		m_dirty = true;
+	}
+
+	bool PatchIndex::setFilename(const std::string& _filename)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if(m_filename == _filename)
+			return true;
+
+		m_filename = _filename;
+
+		return load();
+	}
+
+	bool PatchIndex::save()
+	{
+		std::lock_guard lock(m_mutex);
+
+		if(!m_dirty || m_filename.empty())
+			return false;
+
+		std::ofstream file(m_filename, std::ios::binary | std::ios::trunc);
+
+		if(!file.is_open())
+		{
+			LOG("Failed to write patch index to " << m_filename);
+			return false;
+		}
+
+		auto write = [&](const auto& _v)
+		{
+			file.write(reinterpret_cast<const char*>(&_v), sizeof(_v));
+		};
+
+		auto writeString = [&](const std::string& _s)
+		{
+			write(static_cast<uint32_t>(_s.size()));
+			file.write(_s.c_str(), static_cast<std::streamsize>(_s.size()));
+		};
+
+		write(g_indexFileMagic);
+		write(g_indexFileVersion);
+		write(static_cast<uint32_t>(m_entries.size()));
+
+		for (const auto& it : m_entries)
+		{
+			const auto& e = it.second;
+
+			writeString(e.path);
+			write(e.modificationTime);
+			write(e.size);
+			write(static_cast<uint32_t>(e.patches.size()));
+
+			for (const auto& p : e.patches)
+			{
+				write(p.hash);
+				writeString(p.name);
+				writeString(p.category1);
+				writeString(p.category2);
+				write(p.model);
+				write(p.unison);
+				write(p.transpose);
+				write(p.arpMode);
+				write(p.fileOffset);
+			}
+		}
+
+		m_dirty = false;
+
+		return file.good();
+	}
+
+	bool PatchIndex::load()
+	{
+		std::ifstream file(m_filename, std::ios::binary);
+
+		if(!file.is_open())
+			return false;
+
+		auto read = [&](auto& _v)
+		{
+			file.read(reinterpret_cast<char*>(&_v), sizeof(_v));
+			return file.good();
+		};
+
+		auto readString = [&](std::string& _s)
+		{
+			uint32_t size = 0;
+			if(!read(size) || size > 4096)
+				return false;
+			_s.resize(size);
+			file.read(_s.data(), static_cast<std::streamsize>(size));
+			return file.good();
+		};
+
+		uint32_t magic = 0, version = 0, count = 0;
+
+		if(!read(magic) || !read(version) || magic != g_indexFileMagic || version != g_indexFileVersion)
+		{
+			LOG("Ignoring patch index " << m_filename << ", unknown file format");
+			return false;
+		}
+
+		read(count);
+
+		for(uint32_t i=0; i<count && m_entries.size() < g_maxEntries; ++i)
+		{
+			FileEntry e;
+			uint32_t patchCount = 0;
+
+			bool valid = readString(e.path) && read(e.modificationTime) && read(e.size) && read(patchCount) && patchCount <= 65536;
+
+			for(uint32_t p=0; p<patchCount && valid; ++p)
+			{
+				IndexedPatch patch;
+
+				valid = read(patch.hash) && readString(patch.name) && readString(patch.category1) && readString(patch.category2) &&
+					read(patch.model) && read(patch.unison) && read(patch.transpose) && read(patch.arpMode) && read(patch.fileOffset);
+
+				e.patches.push_back(std::move(patch));
+			}
+
+			if(!valid)
+			{
+				LOG("Patch index " << m_filename << " is truncated, read " << i << " of " << count << " entries");
+				return false;
+			}
+
+			auto path = e.path;
+			m_entries.insert(std::make_pair(std::move(path), std::move(e)));
+		}
+
+		LOG("Loaded " << m_entries.size() << " indexed bank files from " << m_filename);
+		return true;
+	}
+
+	PatchIndex::FileEntry PatchIndex::createEntry(const Virus::Controller& _controller, const juce::File& _file)
+	{
+		FileEntry entry;
+
+		entry.path = _file.getFullPathName().toStdString();
+		entry.modificationTime = _file.getLastModificationTime().toMilliseconds();
+		entry.size = _file.getSize();
+
+		std::vector<Patch> patches;
+		PatchBrowser::loadBankFile(_controller, patches, nullptr, _file);
+
+		entry.patches.reserve(patches.size());
+
+		for (const auto& patch : patches)
+		{
+			IndexedPatch p;
+			p.hash = patch.hash;
+			p.name = patch.name.toStdString();
+			p.category1 = patch.category1;
+			p.category2 = patch.category2;
+			p.model = static_cast<uint8_t>(patch.model);
+			p.unison = patch.unison;
+			p.transpose = patch.transpose;
+			p.arpMode = patch.arpMode;
+			p.fileOffset = patch.fileOffset;
+			entry.patches.push_back(std::move(p));
+		}
+
+		return entry;
+	}
+
+	PatchIndexer::PatchIndexer(const Virus::Controller& _controller, const juce::File& _directory) : m_controller(_controller)
+	{
+		for (const auto& f : juce::RangedDirectoryIterator(_directory, false, "*.syx;*.mid;*.midi", juce::File::findFiles))
+			m_files.push_back(f.getFile());
+
+		m_results.resize(m_files.size());
+		m_resultValid.resize(m_files.size(), false);
+
+		const auto threadCount = std::min(std::max(1u, std::thread::hardware_concurrency() >> 1), g_maxIndexerThreads);
+
+		for(uint32_t i=0; i<threadCount && i<m_files.size(); ++i)
+			m_threads.emplace_back([this] { threadFunc(); });
+	}
+
+	PatchIndexer::~PatchIndexer()
+	{
+		m_cancel = true;
+
+		for (auto& t : m_threads)
+			t.join();
+	}
+
+	bool PatchIndexer::poll(std::vector<PatchIndex::FileEntry>& _entries)
+	{
+		std::lock_guard lock(m_resultsMutex);
+
+		while(m_nextResult < m_results.size() && m_resultValid[m_nextResult])
+		{
+			_entries.push_back(std::move(m_results[m_nextResult]));
+			++m_nextResult;
+		}
+
+		return m_nextResult < m_results.size();
+	}
+
+	void PatchIndexer::threadFunc()
+	{
+		auto& index = PatchIndex::instance();
+
+		while(!m_cancel)
+		{
+			const auto i = m_nextFile++;
+
+			if(i >= m_files.size())
+				return;
+
+			const auto& file = m_files[i];
+
+			PatchIndex::FileEntry entry;
+
+			if(!index.find(entry, file))
+			{
+				entry = PatchIndex::createEntry(m_controller, file);
+				index.add(entry);
+			}
+
+			std::lock_guard lock(m_resultsMutex);
+			m_results[i] = std::move(entry);
+			m_resultValid[i] = true;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+namespace Virus
+{
+	class Controller;
+}
+
+namespace genericVirusUI
+{
+	// Metadata of the patches of bank files, shared by all instances. The index can be persisted so that only files
+	// whose modification time or size changed need to be parsed again in later sessions
+	class PatchIndex
+	{
+	public:
+		struct IndexedPatch
+		{
+			uint64_t hash = 0;
+			std::string name;
+			std::string category1;
+			std::string category2;
+			uint8_t model = 0;
+			uint8_t unison = 0;
+			uint8_t transpose = 0;
+			uint8_t arpMode = 0;
+			uint32_t fileOffset = 0;
+		};
+
+		struct FileEntry
+		{
+			std::string path;
+			int64_t modificationTime = 0;
+			int64_t size = 0;
+			std::vector<IndexedPatch> patches;
+		};
+
+		static PatchIndex& instance();
+
+		// returns false if the file is not indexed or has been modified since
+		bool find(FileEntry& _entry, const juce::File& _file) const;
+		void add(const FileEntry& _entry);
+
+		// enables persistence, existing entries are loaded from the given file
+		bool setFilename(const std::string& _filename);
+
+		// writes the index if it has been modified. Not done on destruction, this is up to the owners of the index
+		bool save();
+
+		static FileEntry createEntry(const Virus::Controller& _controller, const juce::File& _file);
+
+	private:
+		PatchIndex() = default;
+		~PatchIndex() = default;
+
+		bool load();
+
+		mutable std::mutex m_mutex;
+		std::map<std::string, FileEntry> m_entries;
+		std::string m_filename;
+		bool m_dirty = false;
+	};
+
+	// Indexes the bank files of a directory on background threads. Entries are handed out in directory order as soon
+	// as all files before them have been indexed
+	class PatchIndexer
+	{
+	public:
+		PatchIndexer(const Virus::Controller& _controller, const juce::File& _directory);
+		PatchIndexer(const PatchIndexer&) = delete;
+		PatchIndexer(PatchIndexer&&) = delete;
+		~PatchIndexer();
+
+		// appends entries that have been indexed since the last call, returns false once all entries have been handed out
+		bool poll(std::vector<PatchIndex::FileEntry>& _entries);
+
+	private:
+		void threadFunc();
+
+		const Virus::Controller& m_controller;
+
+		std::vector<juce::File> m_files;
+		std::atomic<size_t> m_nextFile = 0;
+		std::atomic<bool> m_cancel = false;
+
+		std::mutex m_resultsMutex;
+		std::vector<PatchIndex::FileEntry> m_results;
+		std::vector<bool> m_resultValid;
+		size_t m_nextResult = 0;
+
+		std::vector<std::thread> m_threads;
+	};
+}
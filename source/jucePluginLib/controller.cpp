@@ -1,21 +1,24 @@
 #include "controller.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "parameter.h"
 
 namespace pluginLib
 {
-	Controller::Controller(const std::string& _parameterDescJson) : m_descriptions(_parameterDescJson)
+	Controller::Controller(const std::string& _parameterDescJson) : m_descriptionsPtr(ParameterDescriptions::get(_parameterDescJson)), m_descriptions(*m_descriptionsPtr)
 	{
 	}
 	
-	void Controller::registerParams(juce::AudioProcessor& _processor)
+	void Controller::registerParams(juce::AudioProcessor& _processor, const uint8_t _hostPartCount/* = 16*/)
     {
 		auto globalParams = std::make_unique<juce::AudioProcessorParameterGroup>("global", "Global", "|");
 
 		std::map<ParamIndex, int> knownParameterIndices;
 
+		initSynthParamLookup();
+
     	for (uint8_t part = 0; part < 16; part++)
 		{
 			m_paramsByParamType[part].reserve(m_descriptions.getDescriptions().size());
@@ -36,6 +39,15 @@ namespace pluginLib
 				else
 					uid = ++itKnownParamIdx->second;
 
+				const bool isNonPartExclusive = desc.isNonPartSensitive();
+
+				if (isNonPartExclusive && part != 0)
+				{
+					// only register on first part!
+					m_paramsByParamType[part].push_back(m_paramsByParamType[0][m_paramsByParamType[part].size()]);
+					continue;
+				}
+
 				std::unique_ptr<Parameter> p;
 				p.reset(createParameter(*this, desc, part, uid));
 
@@ -47,21 +59,10 @@ namespace pluginLib
 						existingParam->addDerivedParameter(p.get());
 				}
 
-				const bool isNonPartExclusive = desc.isNonPartSensitive();
-
-				if (isNonPartExclusive && part != 0)
-				{
-					// only register on first part!
-					m_paramsByParamType[part].push_back(m_paramsByParamType[0][m_paramsByParamType[part].size()]);
-					continue;
-				}
-
 				m_paramsByParamType[part].push_back(p.get());
 
 				if (p->getDescription().isPublic)
 				{
-					// lifecycle managed by Juce
-
 					auto itExisting = m_synthParams.find(idx);
 					if (itExisting != m_synthParams.end())
 					{
@@ -71,16 +72,26 @@ namespace pluginLib
 					{
 						ParameterList params;
 						params.emplace_back(p.get());
-						m_synthParams.insert(std::make_pair(idx, std::move(params)));
+						const auto itNew = m_synthParams.insert(std::make_pair(idx, std::move(params))).first;
+						setSynthParamLookup(idx, itNew->second, true);
 					}
 
 					if (isNonPartExclusive)
 					{
+						// lifecycle managed by Juce
 						jassert(part == 0);
 						globalParams->addChild(std::move(p));
 					}
-					else
+					else if (part < _hostPartCount)
+					{
+						// lifecycle managed by Juce
 						group->addChild(std::move(p));
+					}
+					else
+					{
+						// not visible to the host, lifecycle handled by us
+						m_synthInternalParamList.emplace_back(std::move(p));
+					}
 				}
 				else
 				{
@@ -95,41 +106,82 @@ namespace pluginLib
 					{
 						ParameterList params;
 						params.emplace_back(p.get());
-						m_synthInternalParams.insert(std::make_pair(idx, std::move(params)));
+						const auto itNew = m_synthInternalParams.insert(std::make_pair(idx, std::move(params))).first;
+						setSynthParamLookup(idx, itNew->second, false);
 					}
 					m_synthInternalParamList.emplace_back(std::move(p));
 				}
 			}
-			_processor.addParameterGroup(std::move(group));
+			if(part < _hostPartCount)
+				_processor.addParameterGroup(std::move(group));
 		}
 		_processor.addParameterGroup(std::move(globalParams));
 	}
 
-	const Controller::ParameterList& Controller::findSynthParam(const uint8_t _part, const uint8_t _page, const uint8_t _paramIndex)
+	const Controller::ParameterList& Controller::findSynthParam(const uint8_t _part, const uint8_t _page, const uint8_t _paramIndex) const
 	{
 		const ParamIndex paramIndex{ _page, _part, _paramIndex };
 
 		return findSynthParam(paramIndex);
 	}
 
-	const Controller::ParameterList& Controller::findSynthParam(const ParamIndex& _paramIndex)
+	const Controller::ParameterList& Controller::findSynthParam(const ParamIndex& _paramIndex) const
     {
-		const auto it = m_synthParams.find(_paramIndex);
+		static const ParameterList empty;
 
-		if (it != m_synthParams.end())
-			return it->second;
+		const uint32_t page = _paramIndex.page - m_synthParamLookupFirstPage;
 
-    	const auto iti = m_synthInternalParams.find(_paramIndex);
+		if (_paramIndex.page < m_synthParamLookupFirstPage || page >= m_synthParamLookupPageCount)
+			return empty;
 
-		if (iti == m_synthInternalParams.end())
-		{
-			static ParameterList empty;
+		if (_paramIndex.partNum >= m_paramsByParamType.size() || _paramIndex.paramNum >= m_synthParamLookupParamCount)
 			return empty;
-		}
 
-		return iti->second;
+		const auto* params = m_synthParamLookup[(page * m_paramsByParamType.size() + _paramIndex.partNum) * m_synthParamLookupParamCount + _paramIndex.paramNum];
+
+		return params ? *params : empty;
     }
 
+	void Controller::initSynthParamLookup()
+	{
+		uint32_t firstPage = 0xff;
+		uint32_t lastPage = 0;
+		uint32_t paramCount = 0;
+
+		for (const auto& desc : m_descriptions.getDescriptions())
+		{
+			firstPage = std::min<uint32_t>(firstPage, desc.page);
+			lastPage = std::max<uint32_t>(lastPage, desc.page);
+			paramCount = std::max<uint32_t>(paramCount, desc.index + 1u);
+		}
+
+		m_synthParamLookup.clear();
+
+		if(firstPage > lastPage)
+		{
+			m_synthParamLookupPageCount = 0;
+			return;
+		}
+
+		m_synthParamLookupFirstPage = static_cast<uint8_t>(firstPage);
+		m_synthParamLookupPageCount = lastPage - firstPage + 1;
+		m_synthParamLookupParamCount = paramCount;
+
+		m_synthParamLookup.resize(m_synthParamLookupPageCount * m_paramsByParamType.size() * m_synthParamLookupParamCount, nullptr);
+	}
+
+	void Controller::setSynthParamLookup(const ParamIndex& _paramIndex, const ParameterList& _params, const bool _exposed)
+	{
+		const uint32_t page = _paramIndex.page - m_synthParamLookupFirstPage;
+
+		assert(page < m_synthParamLookupPageCount && _paramIndex.paramNum < m_synthParamLookupParamCount);
+
+		auto& entry = m_synthParamLookup[(page * m_paramsByParamType.size() + _paramIndex.partNum) * m_synthParamLookupParamCount + _paramIndex.paramNum];
+
+		if(_exposed || !entry)
+			entry = &_params;
+	}
+
     juce::Value* Controller::getParamValueObject(const uint32_t _index)
     {
 	    const auto res = getParameter(_index);
@@ -215,14 +267,14 @@ namespace pluginLib
 
 	bool Controller::parseMidiPacket(std::string& _name, MidiPacket::Data& _data, MidiPacket::ParamValues& _parameterValues, const std::vector<uint8_t>& _src) const
 	{
-		const auto packets = m_descriptions.getMidiPackets();
+		const auto& packets = m_descriptions.findMidiPackets(_src);
 
-		for (const auto& packet : packets)
+		for (const auto* packet : packets)
 		{
-			if(!parseMidiPacket(packet.second, _data, _parameterValues, _src))
+			if(!parseMidiPacket(*packet, _data, _parameterValues, _src))
 				continue;
 
-			_name = packet.first;
+			_name = packet->getName();
 			return true;
 		}
 		return false;
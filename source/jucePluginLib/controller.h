@@ -34,11 +34,16 @@ namespace pluginLib
 
 	protected:
 		virtual Parameter* createParameter(Controller& _controller, const Description& _desc, uint8_t _part, int _uid);
-		void registerParams(juce::AudioProcessor& _processor);
+		// Parameters of parts >= _hostPartCount are not registered with the host. The host then only needs to scan the
+		// first parts and the global parameters, the remaining parts are still accessible via the controller.
+		// The part count has to be the same for every instance of a plugin build, hosts address parameters by index.
+		// Unregistered parameters are still full Parameter objects, UI bindings and the controller use them directly
+		void registerParams(juce::AudioProcessor& _processor, uint8_t _hostPartCount = 16);
 
 	private:
 
-        ParameterDescriptions m_descriptions;
+        const std::shared_ptr<const ParameterDescriptions> m_descriptionsPtr;
+        const ParameterDescriptions& m_descriptions;
 
         struct ParamIndex
         {
@@ -61,12 +66,23 @@ namespace pluginLib
 
 		// tries to find synth param in both internal and host
 	protected:
-		const ParameterList& findSynthParam(uint8_t _part, uint8_t _page, uint8_t _paramIndex);
-		const ParameterList& findSynthParam(const ParamIndex& _paramIndex);
+		const ParameterList& findSynthParam(uint8_t _part, uint8_t _page, uint8_t _paramIndex) const;
+		const ParameterList& findSynthParam(const ParamIndex& _paramIndex) const;
 
     	std::map<ParamIndex, ParameterList> m_synthInternalParams;
 		std::map<ParamIndex, ParameterList> m_synthParams; // exposed and managed by audio processor
+
 		std::array<ParameterList, 16> m_paramsByParamType;
 		std::vector<std::unique_ptr<Parameter>> m_synthInternalParamList;
+
+	private:
+		void initSynthParamLookup();
+		void setSynthParamLookup(const ParamIndex& _paramIndex, const ParameterList& _params, bool _exposed);
+
+		// [page][part][param] => parameters, exposed ones take precedence over internal ones
+		std::vector<const ParameterList*> m_synthParamLookup;
+		uint8_t m_synthParamLookupFirstPage = 0;
+		uint32_t m_synthParamLookupPageCount = 0;
+		uint32_t m_synthParamLookupParamCount = 0;
 	};
 }
@@ -13,6 +13,8 @@ namespace pluginLib
 		uint8_t usedMask = 0;
 		uint32_t byteIndex = 0;
 
+		m_definitionToByteIndex.reserve(m_definitions.size());
+
 		for(uint32_t i=0; i<m_definitions.size(); ++i)
 		{
 			const auto& d = m_definitions[i];
@@ -29,8 +31,10 @@ namespace pluginLib
 				++byteIndex;
 			}
 
-			m_definitionToByteIndex.insert(std::make_pair(i, byteIndex));
-			m_byteToDefinitionIndex.insert(std::make_pair(byteIndex, i));
+			m_definitionToByteIndex.push_back(byteIndex);
+
+			if(d.type == MidiDataType::Byte)
+				m_fixedBytes.emplace_back(byteIndex, d.byte);
 
 			usedMask |= masked;
 		}
@@ -44,48 +48,45 @@ namespace pluginLib
 
 		std::map<uint32_t, uint32_t> pendingChecksums;	// byte index => description index
 
-		for(size_t i=0; i<size(); ++i)
+		// definitions are sorted by byte index, the ones sharing a byte are combined in the order they are defined
+		for(uint32_t di=0; di<m_definitions.size(); ++di)
 		{
-			const auto range = m_byteToDefinitionIndex.equal_range(static_cast<uint32_t>(i));
+			const auto& d = m_definitions[di];
+			const auto i = m_definitionToByteIndex[di];
 
-			for(auto itRange = range.first; itRange != range.second; ++itRange)
+			switch (d.type)
 			{
-				const auto& d = m_definitions[itRange->second];
-
-				switch (d.type)
+			case MidiDataType::Null:
+				_dst[i] = 0;
+				break;
+			case MidiDataType::Byte:
+				_dst[i] = d.byte;
+				break;
+			case MidiDataType::Parameter:
 				{
-				case MidiDataType::Null:
-					_dst[i] = 0;
-					break;
-				case MidiDataType::Byte:
-					_dst[i] = d.byte;
-					break;
-				case MidiDataType::Parameter:
+					const auto it = _paramValues.find(std::make_pair(d.paramPart, d.paramName));
+					if(it == _paramValues.end())
 					{
-						const auto it = _paramValues.find(std::make_pair(d.paramPart, d.paramName));
-						if(it == _paramValues.end())
-						{
-							LOG("Failed to find value for parameter " << d.paramName << ", part " << d.paramPart);
-							return false;
-						}
-						_dst[i] |= (it->second & d.paramMask) << d.paramShift;
+						LOG("Failed to find value for parameter " << d.paramName << ", part " << d.paramPart);
+						return false;
 					}
-					break;
-				case MidiDataType::Checksum:
-					pendingChecksums.insert(std::make_pair(static_cast<uint32_t>(i), itRange->second));
-					break;
-				default:
-					{
-						const auto it = _data.find(d.type);
-
-						if(it == _data.end())
-						{
-							LOG("Failed to find data of type " << static_cast<int>(d.type) << " to fill byte " << i << " of midi packet");
-							return false;
-						}
+					_dst[i] |= (it->second & d.paramMask) << d.paramShift;
+				}
+				break;
+			case MidiDataType::Checksum:
+				pendingChecksums.insert(std::make_pair(i, di));
+				break;
+			default:
+				{
+					const auto it = _data.find(d.type);
 
-						_dst[i] = it->second;
+					if(it == _data.end())
+					{
+						LOG("Failed to find data of type " << static_cast<int>(d.type) << " to fill byte " << i << " of midi packet");
+						return false;
 					}
+
+					_dst[i] = it->second;
 				}
 			}
 		}
@@ -106,66 +107,74 @@ namespace pluginLib
 		return create(_dst, _data, {});
 	}
 
-	bool MidiPacket::parse(Data& _data, ParamValues& _parameterValues, const ParameterDescriptions& _parameters, const Sysex& _src, bool _ignoreChecksumErrors/* = true*/) const
+	bool MidiPacket::matchesFixedBytes(const Sysex& _src) const
 	{
 		if(_src.size() != size())
 			return false;
 
-		for(size_t i=0; i<_src.size(); ++i)
+		for (const auto& fixed : m_fixedBytes)
 		{
-			const auto s = _src[i];
+			if(_src[fixed.first] != fixed.second)
+				return false;
+		}
+		return true;
+	}
 
-			const auto range = m_byteToDefinitionIndex.equal_range(static_cast<uint32_t>(i));
+	bool MidiPacket::parse(Data& _data, ParamValues& _parameterValues, const ParameterDescriptions& _parameters, const Sysex& _src, bool _ignoreChecksumErrors/* = true*/) const
+	{
+		// reject foreign packets before anything is extracted
+		if(!matchesFixedBytes(_src))
+			return false;
 
-			for(auto it = range.first; it != range.second; ++it)
-			{
-				const auto& d = m_definitions[it->second];
+		_parameterValues.setParameterCount(static_cast<uint32_t>(_parameters.getDescriptions().size()));
 
-				switch (d.type)
+		for(uint32_t di=0; di<m_definitions.size(); ++di)
+		{
+			const auto& d = m_definitions[di];
+			const auto i = m_definitionToByteIndex[di];
+			const auto s = _src[i];
+
+			switch (d.type)
+			{
+			case MidiDataType::Null: 
+			case MidiDataType::Byte:
+				continue;
+			case MidiDataType::Checksum:
 				{
-				case MidiDataType::Null: 
-					continue;
-				case MidiDataType::Byte:
-					if(d.byte != s)
-						return false;
-					break;
-				case MidiDataType::Checksum:
+					const uint8_t checksum = calcChecksum(d, _src);
+
+					if(checksum != s)
 					{
-						const uint8_t checksum = calcChecksum(d, _src);
-
-						if(checksum != s)
-						{
-							LOG("Packet checksum error, calculated " << std::hex << static_cast<int>(checksum) << " but data contains " << static_cast<int>(s));
-							if(!_ignoreChecksumErrors)
-								return false;
-						}
+						LOG("Packet checksum error, calculated " << std::hex << static_cast<int>(checksum) << " but data contains " << static_cast<int>(s));
+						if(!_ignoreChecksumErrors)
+							return false;
 					}
-					continue;
-				case MidiDataType::DeviceId:
-				case MidiDataType::Bank:
-				case MidiDataType::Program:
-				case MidiDataType::ParameterIndex:
-				case MidiDataType::ParameterValue:
-				case MidiDataType::Page:
-				case MidiDataType::Part:
-					_data.insert(std::make_pair(d.type, s));
-					break;
-				case MidiDataType::Parameter:
+				}
+				continue;
+			case MidiDataType::DeviceId:
+			case MidiDataType::Bank:
+			case MidiDataType::Program:
+			case MidiDataType::ParameterIndex:
+			case MidiDataType::ParameterValue:
+			case MidiDataType::Page:
+			case MidiDataType::Part:
+				_data.insert(std::make_pair(d.type, s));
+				break;
+			case MidiDataType::Parameter:
+				{
+					uint32_t idx = d.paramIndex;
+					if(idx == InvalidIndex && !_parameters.getIndexByName(idx, d.paramName))
 					{
-						uint32_t idx;
-						if(!_parameters.getIndexByName(idx, d.paramName))
-						{
-							LOG("Failed to find named parameter " << d.paramName << " while parsing midi packet, midi byte " << i);
-							return false;
-						}
-						const auto sMasked = (s >> d.paramShift) & d.paramMask;
-						_parameterValues.insert(std::make_pair(std::make_pair(d.paramPart, idx), sMasked));
+						LOG("Failed to find named parameter " << d.paramName << " while parsing midi packet, midi byte " << i);
+						return false;
 					}
-					break;
-				default:
-					assert(false && "unknown data type");
-					return false;
+					const auto sMasked = (s >> d.paramShift) & d.paramMask;
+					_parameterValues.set(d.paramPart, idx, static_cast<uint8_t>(sMasked));
 				}
+				break;
+			default:
+				assert(false && "unknown data type");
+				return false;
 			}
 		}
 		return true;
@@ -181,8 +190,8 @@ namespace pluginLib
 			if(d.type != MidiDataType::Parameter)
 				continue;
 
-			uint32_t index;
-			if(!_parameters.getIndexByName(index, d.paramName))
+			uint32_t index = d.paramIndex;
+			if(index == InvalidIndex && !_parameters.getIndexByName(index, d.paramName))
 			{
 				LOG("Failed to retrieve index for parameter " << d.paramName);
 				return false;
@@ -201,7 +210,7 @@ namespace pluginLib
 			if(d.type != _type)
 				continue;
 
-			return m_definitionToByteIndex.find(i)->second;
+			return m_definitionToByteIndex[i];
 		}
 		return InvalidIndex;
 	}
@@ -218,7 +227,7 @@ namespace pluginLib
 			if(d.paramName != _name)
 				continue;
 
-			return m_definitionToByteIndex.find(i)->second;
+			return m_definitionToByteIndex[i];
 		}
 		return InvalidIndex;
 	}
@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "paramvalues.h"
+
 namespace pluginLib
 {
 	class ParameterDescriptions;
@@ -28,7 +30,7 @@ namespace pluginLib
 	class MidiPacket
 	{
 	public:
-		static constexpr uint8_t AnyPart = 0xff;
+		static constexpr uint8_t AnyPart = pluginLib::ParamValues::AnyPart;
 		static constexpr uint32_t InvalidIndex = 0xffffffff;
 
 		struct MidiDataDefinition
@@ -41,6 +43,7 @@ namespace pluginLib
 			uint8_t paramMask = 0xff;
 			uint8_t paramShift = 0;
 			uint8_t paramPart = AnyPart;
+			uint32_t paramIndex = InvalidIndex;	// resolved from paramName when the packet is loaded
 
 			uint32_t checksumFirstIndex = 0;
 			uint32_t checksumLastIndex = 0;
@@ -48,18 +51,23 @@ namespace pluginLib
 		};
 
 		using Data = std::map<MidiDataType, uint8_t>;
-		using ParamIndex = std::pair<uint8_t,uint32_t>;
+		using ParamIndex = pluginLib::ParamValues::ParamIndex;
 		using ParamIndices = std::set<ParamIndex>;
-		using ParamValues = std::map<ParamIndex, uint8_t>;	// part, index => value
+		using ParamValues = pluginLib::ParamValues;
 		using NamedParamValues = std::map<std::pair<uint8_t,std::string>, uint8_t>;	// part, name => value
 		using Sysex = std::vector<uint8_t>;
+		using FixedBytes = std::vector<std::pair<uint32_t, uint8_t>>;	// byte index => value
 
 		MidiPacket() = default;
 		explicit MidiPacket(std::string _name, std::vector<MidiDataDefinition>&& _bytes);
 
-		const std::vector<MidiDataDefinition>& definitions() { return m_definitions; }
+		const std::string& getName() const { return m_name; }
+		const std::vector<MidiDataDefinition>& definitions() const { return m_definitions; }
+		const FixedBytes& getFixedBytes() const { return m_fixedBytes; }
 		uint32_t size() const { return m_byteSize; }
 
+		bool matchesFixedBytes(const Sysex& _src) const;
+
 		bool create(std::vector<uint8_t>& _dst, const Data& _data, const NamedParamValues& _paramValues) const;
 		bool create(std::vector<uint8_t>& _dst, const Data& _data) const;
 		bool parse(Data& _data, ParamValues& _parameterValues, const ParameterDescriptions& _parameters, const Sysex& _src, bool _ignoreChecksumErrors = true) const;
@@ -73,8 +81,8 @@ namespace pluginLib
 
 		const std::string m_name;
 		std::vector<MidiDataDefinition> m_definitions;
-		std::map<uint32_t, uint32_t> m_definitionToByteIndex;
-		std::multimap<uint32_t, uint32_t> m_byteToDefinitionIndex;
+		std::vector<uint32_t> m_definitionToByteIndex;
+		FixedBytes m_fixedBytes;
 		uint32_t m_byteSize = 0;
 		bool m_hasParameters = false;
 	};
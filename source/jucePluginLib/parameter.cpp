@@ -40,7 +40,7 @@ namespace pluginLib
 		m_lastValue = newValue;
 		m_lastValueOrigin = _origin;
 
-		if(getDescription().isPublic)
+		if(isRegisteredWithHost())
 		{
 			beginChangeGesture();
 			const float v = convertTo0to1(static_cast<float>(newValue));
@@ -93,7 +93,7 @@ namespace pluginLib
 		m_lastValue = clampedValue;
 		m_lastValueOrigin = _origin;
 
-		if (notifyHost && getDescription().isPublic)
+		if (notifyHost && isRegisteredWithHost())
 		{
 			beginChangeGesture();
 			const auto v = convertTo0to1(static_cast<float>(clampedValue));
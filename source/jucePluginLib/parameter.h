@@ -79,13 +79,16 @@ namespace pluginLib
 
 		ChangedBy getChangeOrigin() const { return m_lastValueOrigin; }
 
+		// public parameters of parts that are not exposed to the host are not registered with it
+		bool isRegisteredWithHost() const { return getParameterIndex() >= 0; }
+
 	private:
         static juce::String genId(const Description &d, int part, int uniqueId);
 		void valueChanged(juce::Value &) override;
 		void setDerivedValue(int _value, ChangedBy _origin);
 
         Controller &m_ctrl;
-		const Description m_desc;
+		const Description& m_desc;	// owned by the shared ParameterDescriptions, which outlive all parameters
 		juce::NormalisableRange<float> m_range;
 		const uint8_t m_partNum;
 		const int m_uniqueId;	// 0 for all unique parameters, > 0 if multiple Parameter instances reference a single synth parameter
@@ -1,6 +1,8 @@
 #include "parameterdescriptions.h"
 
 #include <cassert>
+#include <mutex>
+#include <set>
 
 #include "../dsp56300/source/dsp56kEmu/logging.h"
 
@@ -12,12 +14,43 @@ namespace pluginLib
 		LOG(err);
 	}
 
+	std::shared_ptr<const ParameterDescriptions> ParameterDescriptions::get(const std::string& _jsonString)
+	{
+		static std::mutex mutex;
+		static std::map<std::string, std::shared_ptr<const ParameterDescriptions>> cache;
+
+		std::lock_guard lock(mutex);
+
+		auto& descriptions = cache[_jsonString];
+
+		if(!descriptions)
+			descriptions = std::make_shared<const ParameterDescriptions>(_jsonString);
+
+		return descriptions;
+	}
+
 	const MidiPacket* ParameterDescriptions::getMidiPacket(const std::string& _name) const
 	{
 		const auto it = m_midiPackets.find(_name);
 		return it == m_midiPackets.end() ? nullptr : &it->second;
 	}
 
+	const std::vector<const MidiPacket*>& ParameterDescriptions::findMidiPackets(const MidiPacket::Sysex& _sysex) const
+	{
+		static const std::vector<const MidiPacket*> empty;
+
+		const auto itSize = m_midiPacketDispatch.find(static_cast<uint32_t>(_sysex.size()));
+		if(itSize == m_midiPacketDispatch.end())
+			return empty;
+
+		const auto& dispatch = itSize->second;
+
+		const auto key = dispatch.byteIndex != MidiPacket::InvalidIndex ? _sysex[dispatch.byteIndex] : static_cast<uint8_t>(0);
+
+		const auto it = dispatch.packets.find(key);
+		return it == dispatch.packets.end() ? empty : it->second;
+	}
+
 	std::string ParameterDescriptions::removeComments(std::string _json)
 	{
 		auto removeBlock = [&](const std::string& _begin, const std::string& _end)
@@ -347,6 +380,8 @@ namespace pluginLib
 
 			parseMidiPacket(_errors, key, value);
 		}
+
+		createMidiPacketDispatch();
 	}
 
 	void ParameterDescriptions::parseMidiPacket(std::stringstream& _errors, const std::string& _key, const juce::var& _value)
@@ -449,6 +484,10 @@ namespace pluginLib
 					byte.paramPart = static_cast<uint8_t>(part);
 				}
 
+				uint32_t index;
+				if(getIndexByName(index, byte.paramName))
+					byte.paramIndex = index;
+
 				byte.type = MidiDataType::Parameter;
 			}
 			else if(type == "checksum")
@@ -504,9 +543,7 @@ namespace pluginLib
 			}
 			else if(p.type == MidiDataType::Parameter)
 			{
-				uint32_t index;
-
-				if(!getIndexByName(index, p.paramName))
+				if(p.paramIndex == MidiPacket::InvalidIndex)
 				{
 					hasErrors = true;
 					_errors << "specified parameter " << p.paramName << " does not exist" << std::endl;
@@ -518,6 +555,69 @@ namespace pluginLib
 			m_midiPackets.insert(std::make_pair(_key, packet));
 	}
 
+	void ParameterDescriptions::createMidiPacketDispatch()
+	{
+		std::map<uint32_t, std::vector<const MidiPacket*>> packetsBySize;
+
+		for (const auto& it : m_midiPackets)
+			packetsBySize[it.second.size()].push_back(&it.second);
+
+		for (const auto& it : packetsBySize)
+		{
+			const auto& packets = it.second;
+
+			// use the byte that is fixed in all packets of this size and has the most distinct values, usually the command byte
+			std::map<uint32_t, std::set<uint8_t>> candidates;
+
+			for (const auto& fixed : packets.front()->getFixedBytes())
+				candidates[fixed.first];
+
+			for (const auto* packet : packets)
+			{
+				std::map<uint32_t, std::set<uint8_t>> remaining;
+
+				for (const auto& fixed : packet->getFixedBytes())
+				{
+					auto itCandidate = candidates.find(fixed.first);
+					if(itCandidate == candidates.end())
+						continue;
+					itCandidate->second.insert(fixed.second);
+					remaining.insert(*itCandidate);
+				}
+				candidates.swap(remaining);
+			}
+
+			MidiPacketDispatch dispatch;
+			size_t bestCount = 1;
+
+			for (const auto& candidate : candidates)
+			{
+				if(candidate.second.size() <= bestCount)
+					continue;
+				bestCount = candidate.second.size();
+				dispatch.byteIndex = candidate.first;
+			}
+
+			for (const auto* packet : packets)
+			{
+				uint8_t key = 0;
+
+				if(dispatch.byteIndex != MidiPacket::InvalidIndex)
+				{
+					for (const auto& fixed : packet->getFixedBytes())
+					{
+						if(fixed.first == dispatch.byteIndex)
+							key = fixed.second;
+					}
+				}
+
+				dispatch.packets[key].push_back(packet);
+			}
+
+			m_midiPacketDispatch.insert(std::make_pair(it.first, std::move(dispatch)));
+		}
+	}
+
 	void ParameterDescriptions::parseParameterLinks(std::stringstream& _errors, juce::Array<juce::var>* _links)
 	{
 		if(!_links)
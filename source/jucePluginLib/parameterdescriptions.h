@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,12 @@ namespace pluginLib
 	public:
 		explicit ParameterDescriptions(const std::string& _jsonString);
 
+		ParameterDescriptions(const ParameterDescriptions&) = delete;
+		ParameterDescriptions& operator = (const ParameterDescriptions&) = delete;
+
+		// descriptions are parsed once per process and shared by all instances that use the same JSON
+		static std::shared_ptr<const ParameterDescriptions> get(const std::string& _jsonString);
+
 		const std::vector<Description>& getDescriptions() const
 		{
 			return m_descriptions;
@@ -28,10 +35,14 @@ namespace pluginLib
 
 		const std::map<std::string, MidiPacket>& getMidiPackets() const { return m_midiPackets; }
 
+		// returns the packets that may match the sysex message, selected by message size and a command byte
+		const std::vector<const MidiPacket*>& findMidiPackets(const MidiPacket::Sysex& _sysex) const;
+
 	private:
 		std::string loadJson(const std::string& _jsonString);
 		void parseMidiPackets(std::stringstream& _errors, juce::DynamicObject* _packets);
 		void parseMidiPacket(std::stringstream& _errors, const std::string& _key, const juce::var& _value);
+		void createMidiPacketDispatch();
 
 		void parseParameterLinks(std::stringstream& _errors, juce::Array<juce::var>* _links);
 		void parseParameterLink(std::stringstream& _errors, const juce::var& _value);
@@ -40,6 +51,14 @@ namespace pluginLib
 		std::vector<Description> m_descriptions;
 		std::map<std::string, uint32_t> m_nameToIndex;
 		std::map<std::string, MidiPacket> m_midiPackets;
+
+		struct MidiPacketDispatch
+		{
+			uint32_t byteIndex = MidiPacket::InvalidIndex;	// fixed in all packets of this size, the value selects the packet
+			std::map<uint8_t, std::vector<const MidiPacket*>> packets;
+		};
+
+		std::map<uint32_t, MidiPacketDispatch> m_midiPacketDispatch;	// packet size => dispatch
 		std::vector<ParameterLink> m_parameterLinks;
 	};
 }
@@ -0,0 +1,47 @@
+#include "paramvalues.h"
+
+#include <cassert>
+
+namespace pluginLib
+{
+	void ParamValues::setParameterCount(const uint32_t _count)
+	{
+		if(_count == m_parameterCount)
+			return;
+
+		m_parameterCount = _count;
+		m_entryIndices.clear();
+		m_entries.clear();
+	}
+
+	void ParamValues::set(const uint8_t _part, const uint32_t _index, const uint8_t _value)
+	{
+		assert(_index < m_parameterCount && "parameter count needs to be set first");
+		if(_index >= m_parameterCount)
+			return;
+
+		const auto i = toSlot(_part) * m_parameterCount + _index;
+
+		// slots are only allocated up to the highest one in use, packets without parts only need the first one
+		if(i >= m_entryIndices.size())
+			m_entryIndices.resize((toSlot(_part) + 1) * m_parameterCount, 0);
+
+		auto& entryIndex = m_entryIndices[i];
+
+		if(entryIndex)
+		{
+			m_entries[entryIndex - 1].second = _value;
+			return;
+		}
+
+		m_entries.emplace_back(ParamIndex(_part, _index), _value);
+		entryIndex = static_cast<uint32_t>(m_entries.size());
+	}
+
+	void ParamValues::clear()
+	{
+		for (const auto& e : m_entries)
+			m_entryIndices[toSlot(e.first.first) * m_parameterCount + e.first.second] = 0;
+		m_entries.clear();
+	}
+}
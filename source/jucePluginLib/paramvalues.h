@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pluginLib
+{
+	// Parameter values of a parsed midi packet. Values are stored densely, addressed by part and parameter index, and
+	// the storage is kept when cleared so that an instance can be reused without allocating again
+	class ParamValues
+	{
+	public:
+		static constexpr uint8_t AnyPart = 0xff;
+
+		using ParamIndex = std::pair<uint8_t, uint32_t>;	// part, index
+		using Entry = std::pair<ParamIndex, uint8_t>;		// part, index => value
+		using Entries = std::vector<Entry>;
+
+		// resets the storage if the parameter count differs
+		void setParameterCount(uint32_t _count);
+
+		void set(uint8_t _part, uint32_t _index, uint8_t _value);
+
+		const uint8_t* find(uint8_t _part, uint32_t _index) const
+		{
+			const auto i = getEntryIndex(_part, _index);
+			return i ? &m_entries[i - 1].second : nullptr;
+		}
+
+		uint8_t get(uint8_t _part, uint32_t _index, uint8_t _default = 0) const
+		{
+			const auto* v = find(_part, _index);
+			return v ? *v : _default;
+		}
+
+		void clear();
+
+		bool empty() const { return m_entries.empty(); }
+		size_t size() const { return m_entries.size(); }
+
+		Entries::const_iterator begin() const { return m_entries.begin(); }
+		Entries::const_iterator end() const { return m_entries.end(); }
+
+	private:
+		// slot 0 is used for AnyPart, slots 1-16 for parts 0-15
+		static uint32_t toSlot(const uint8_t _part) { return _part == AnyPart ? 0 : _part + 1u; }
+
+		uint32_t getEntryIndex(const uint8_t _part, const uint32_t _index) const
+		{
+			if(_index >= m_parameterCount)
+				return 0;
+			const auto i = toSlot(_part) * m_parameterCount + _index;
+			return i < m_entryIndices.size() ? m_entryIndices[i] : 0;
+		}
+
+		uint32_t m_parameterCount = 0;
+		std::vector<uint32_t> m_entryIndices;	// slot * parameter count + index => entry index + 1, zero if not set
+		Entries m_entries;
+	};
+}
@@ -1,5 +1,6 @@
 #include "editor.h"
 
+#include "resourceCache.h"
 #include "uiObject.h"
 
 #include "../synthLib/os.h"
@@ -12,13 +13,14 @@ namespace genericUI
 
 	void Editor::create(const std::string& _jsonFilename)
 	{
+		auto& cache = ResourceCache::getInstance();
+
 		uint32_t jsonSize;
 		const auto jsonData = m_interface.getResourceByFilename(_jsonFilename, jsonSize);
 
-		juce::var json;
-		const auto error = juce::JSON::parse(juce::String(std::string(jsonData, jsonSize)), json);
+		const auto json = cache.getJson(jsonData, jsonSize);
 
-		if (error.failed())
+		if (json.isVoid())
 			throw std::runtime_error("Failed to load json");
 
 		m_jsonFilename = _jsonFilename;
@@ -36,7 +38,7 @@ namespace genericUI
 			const auto* data = m_interface.getResourceByFilename(dataName, dataSize);
 			if (!data)
 				throw std::runtime_error("Failed to find image named " + dataName);
-			auto drawable = juce::Drawable::createFromImageData(data, dataSize);
+			auto drawable = cache.getDrawable(data, dataSize);
 			m_drawables.insert(std::make_pair(texture, std::move(drawable)));
 		}
 
@@ -51,7 +53,7 @@ namespace genericUI
 			const auto* data = m_interface.getResourceByFilename(dataName, dataSize);
 			if (!data)
 				throw std::runtime_error("Failed to find font named " + dataName);
-			auto font = juce::Font(juce::Typeface::createSystemTypefaceFor(data, dataSize));
+			auto font = juce::Font(cache.getTypeface(data, dataSize));
 			m_fonts.insert(std::make_pair(fontFile, std::move(font)));
 		}
 
@@ -82,7 +82,7 @@ namespace genericUI
 
 		std::string m_jsonFilename;
 
-		std::map<std::string, std::unique_ptr<juce::Drawable>> m_drawables;
+		std::map<std::string, std::shared_ptr<juce::Drawable>> m_drawables;	// shared with other editors via the ResourceCache
 		std::map<std::string, juce::Font> m_fonts;
 
 		std::unique_ptr<UiObject> m_rootObject;
@@ -0,0 +1,144 @@
+#include "resourceCache.h"
+
+#include <algorithm>
+
+#include "../synthLib/hash.h"
+
+namespace genericUI
+{
+	namespace
+	{
+		ResourceCache* g_instance = nullptr;
+	}
+
+	ResourceCache::~ResourceCache()
+	{
+		g_instance = nullptr;
+	}
+
+	ResourceCache& ResourceCache::getInstance()
+	{
+		if(!g_instance)
+			g_instance = new ResourceCache();
+		return *g_instance;
+	}
+
+	juce::var ResourceCache::getJson(const char* _data, const uint32_t _size)
+	{
+		if(!_data)
+			return {};
+
+		const auto key = createKey(_data, _size);
+
+		const auto it = m_json.find(key);
+		if(it != m_json.end())
+			return it->second;
+
+		juce::var json;
+		const auto error = juce::JSON::parse(juce::String(std::string(_data, _size)), json);
+
+		if(error.failed())
+			return {};
+
+		m_json.insert(std::make_pair(key, json));
+		return json;
+	}
+
+	std::shared_ptr<juce::Drawable> ResourceCache::getDrawable(const char* _data, const uint32_t _size)
+	{
+		if(!_data)
+			return {};
+
+		const auto key = createKey(_data, _size);
+
+		const auto it = m_drawables.find(key);
+		if(it != m_drawables.end())
+		{
+			it->second.lastUsed = ++m_useCounter;
+			return it->second.drawable;
+		}
+
+		std::shared_ptr<juce::Drawable> drawable = juce::Drawable::createFromImageData(_data, _size);
+
+		if(!drawable)
+			return {};
+
+		CachedDrawable entry;
+		entry.drawable = drawable;
+		entry.memorySize = getMemorySize(*drawable);
+		entry.lastUsed = ++m_useCounter;
+
+		m_imageMemoryUsage += entry.memorySize;
+		m_drawables.insert(std::make_pair(key, std::move(entry)));
+
+		evictImages();
+
+		return drawable;
+	}
+
+	juce::Typeface::Ptr ResourceCache::getTypeface(const char* _data, const uint32_t _size)
+	{
+		if(!_data)
+			return {};
+
+		const auto key = createKey(_data, _size);
+
+		const auto it = m_typefaces.find(key);
+		if(it != m_typefaces.end())
+			return it->second;
+
+		auto typeface = juce::Typeface::createSystemTypefaceFor(_data, _size);
+
+		if(typeface)
+			m_typefaces.insert(std::make_pair(key, typeface));
+
+		return typeface;
+	}
+
+	void ResourceCache::setImageMemoryBudget(const size_t _bytes)
+	{
+		m_imageMemoryBudget = _bytes;
+		evictImages();
+	}
+
+	uint64_t ResourceCache::createKey(const char* _data, const uint32_t _size)
+	{
+		// skins loaded from disk are held per editor, the data pointer is not a stable key. Hash the content instead
+		return synthLib::hash(&_size, sizeof(_size), synthLib::hash(_data, _size));
+	}
+	size_t ResourceCache::getMemorySize(const juce::Drawable& _drawable)
+	{
+		if(const auto* image = dynamic_cast<const juce::DrawableImage*>(&_drawable))
+		{
+			const auto& img = image->getImage();
+			return static_cast<size_t>(img.getWidth()) * static_cast<size_t>(img.getHeight()) * 4;
+		}
+
+		const auto bounds = _drawable.getDrawableBounds();
+		return static_cast<size_t>(std::max(0.0f, bounds.getWidth() * bounds.getHeight())) * 4;
+	}
+
+	void ResourceCache::evictImages()
+	{
+		while(m_imageMemoryUsage > m_imageMemoryBudget)
+		{
+			// images that are still used by an editor are not evicted, they would be decoded again by the next editor
+			auto oldest = m_drawables.end();
+
+			for(auto it = m_drawables.begin(); it != m_drawables.end(); ++it)
+			{
+				if(it->second.drawable.use_count() > 1)
+					continue;
+
+				if(oldest == m_drawables.end() || it->second.lastUsed < oldest->second.lastUsed)
+					oldest = it;
+			}
+
+			if(oldest == m_drawables.end())
+				return;
+
+			m_imageMemoryUsage -= oldest->second.memorySize;
+			m_drawables.erase(oldest);
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+namespace genericUI
+{
+	// Process wide cache for skin resources that are expensive to create. Parsed json, decoded images and typefaces are
+	// shared between all editors that use the same resource data. The cache is deleted when Juce shuts down and must
+	// only be used from the message thread
+	class ResourceCache : juce::DeletedAtShutdown
+	{
+	public:
+		ResourceCache(const ResourceCache&) = delete;
+		ResourceCache(ResourceCache&&) = delete;
+		~ResourceCache() override;
+
+		static ResourceCache& getInstance();
+
+		// returns a void var if the data couldn't be parsed
+		juce::var getJson(const char* _data, uint32_t _size);
+
+		std::shared_ptr<juce::Drawable> getDrawable(const char* _data, uint32_t _size);
+
+		juce::Typeface::Ptr getTypeface(const char* _data, uint32_t _size);
+
+		// Decoded images that are not used by any editor anymore are kept until the budget is exceeded, least recently used first
+		void setImageMemoryBudget(size_t _bytes);
+		size_t getImageMemoryBudget() const { return m_imageMemoryBudget; }
+		size_t getImageMemoryUsage() const { return m_imageMemoryUsage; }
+
+	private:
+		struct CachedDrawable
+		{
+			std::shared_ptr<juce::Drawable> drawable;
+			size_t memorySize = 0;
+			uint64_t lastUsed = 0;
+		};
+
+		ResourceCache() = default;
+
+		static uint64_t createKey(const char* _data, uint32_t _size);
+		static size_t getMemorySize(const juce::Drawable& _drawable);
+
+		void evictImages();
+
+		std::map<uint64_t, juce::var> m_json;
+		std::map<uint64_t, CachedDrawable> m_drawables;
+		std::map<uint64_t, juce::Typeface::Ptr> m_typefaces;
+
+		size_t m_imageMemoryBudget = 256 * 1024 * 1024;
+		size_t m_imageMemoryUsage = 0;
+		uint64_t m_useCounter = 0;
+	};
+}
@@ -0,0 +1,275 @@
+#include "audioCompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "mappedFile.h"
+#include "wavReader.h"
+#include "wavWriter.h"
+
+namespace synthLib
+{
+	namespace
+	{
+		constexpr size_t g_blockFrames = 4096;
+
+		bool isSupportedFormat(const Data& _data)
+		{
+			if(_data.isFloat)
+				return _data.bitsPerSample == 32;
+			return _data.bitsPerSample == 16 || _data.bitsPerSample == 24 || _data.bitsPerSample == 32;
+		}
+
+		bool isSameFormat(const Data& _a, const Data& _b)
+		{
+			return _a.isFloat == _b.isFloat && _a.bitsPerSample == _b.bitsPerSample && _a.channels == _b.channels;
+		}
+
+		// converts to float in range -1..1. The loops are kept branch free so that the compiler is able to vectorize them
+		void decode(float* _dst, const uint8_t* _src, const size_t _count, const Data& _format)
+		{
+			if(_format.isFloat)
+			{
+				memcpy(_dst, _src, _count * sizeof(float));
+				return;
+			}
+
+			switch (_format.bitsPerSample)
+			{
+			case 16:
+				for(size_t i=0; i<_count; ++i, _src += 2)
+				{
+					const auto v = static_cast<int16_t>(static_cast<uint16_t>(_src[0] | _src[1] << 8));
+					_dst[i] = static_cast<float>(v) * (1.0f / 32768.0f);
+				}
+				break;
+			case 24:
+				for(size_t i=0; i<_count; ++i, _src += 3)
+				{
+					const auto v = static_cast<int32_t>(static_cast<uint32_t>(_src[0]) << 8 | static_cast<uint32_t>(_src[1]) << 16 | static_cast<uint32_t>(_src[2]) << 24) >> 8;
+					_dst[i] = static_cast<float>(v) * (1.0f / 8388608.0f);
+				}
+				break;
+			case 32:
+				for(size_t i=0; i<_count; ++i, _src += 4)
+				{
+					int32_t v;
+					memcpy(&v, _src, sizeof(v));
+					_dst[i] = static_cast<float>(v) * (1.0f / 2147483648.0f);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	AudioCompare::Result AudioCompare::compareFiles(const std::string& _filename, const std::string& _referenceFilename, const Options& _options)
+	{
+		Result result;
+
+		MappedFile fileA;
+		MappedFile fileB;
+
+		if(!fileA.open(_filename))
+		{
+			result.error = "Failed to open file " + _filename;
+			return result;
+		}
+
+		if(!fileB.open(_referenceFilename))
+		{
+			result.error = "Failed to open file " + _referenceFilename;
+			return result;
+		}
+
+		Data a;
+		Data b;
+
+		if(!WavReader::load(a, nullptr, fileA.data(), fileA.size()))
+		{
+			result.error = "Failed to interpret file " + _filename + " as wave data";
+			return result;
+		}
+
+		if(!WavReader::load(b, nullptr, fileB.data(), fileB.size()))
+		{
+			result.error = "Failed to interpret file " + _referenceFilename + " as wave data";
+			return result;
+		}
+
+		return compare(a, b, _options);
+	}
+
+	AudioCompare::Result AudioCompare::compare(const Data& _data, const Data& _reference, const Options& _options)
+	{
+		Result result;
+
+		if(!isSupportedFormat(_data) || !isSupportedFormat(_reference))
+		{
+			result.error = "Unsupported sample format, only 16, 24 and 32 bit integer and 32 bit float data is supported";
+			return result;
+		}
+
+		if(_data.channels != _reference.channels || !_data.channels)
+		{
+			result.error = "Channel count mismatch, got " + std::to_string(_data.channels) + " but reference has " + std::to_string(_reference.channels);
+			return result;
+		}
+
+		if(_data.samplerate != _reference.samplerate)
+		{
+			result.error = "Samplerate mismatch, got " + std::to_string(_data.samplerate) + " but reference has " + std::to_string(_reference.samplerate);
+			return result;
+		}
+
+		const auto channels = _data.channels;
+		const size_t frameSizeA = (_data.bitsPerSample >> 3) * channels;
+		const size_t frameSizeB = (_reference.bitsPerSample >> 3) * channels;
+
+		result.channels = channels;
+		result.frameCountA = _data.dataByteSize / frameSizeA;
+		result.frameCountB = _reference.dataByteSize / frameSizeB;
+		result.frameCount = std::min(result.frameCountA, result.frameCountB);
+		result.firstDifference.assign(channels, -1);
+
+		WavWriter diffWriter;
+
+		if(!_options.diffFilename.empty())
+			diffWriter.open(_options.diffFilename, 32, true, static_cast<int>(channels), static_cast<int>(_reference.samplerate));
+
+		const bool sameFormat = isSameFormat(_data, _reference);
+		const bool needsReferenceEnergy = _options.mode == Mode::RelativeDb;
+
+		std::vector<float> bufA(g_blockFrames * channels);
+		std::vector<float> bufB(g_blockFrames * channels);
+		std::vector<float> bufDiff(g_blockFrames * channels);
+
+		const auto* srcA = static_cast<const uint8_t*>(_data.data);
+		const auto* srcB = static_cast<const uint8_t*>(_reference.data);
+
+		double sumErr = 0.0;
+		double sumRef = 0.0;
+		float maxErr = 0.0f;
+		uint32_t missingFirstDifferences = channels;
+
+		for(uint64_t frame = 0; frame < result.frameCount; frame += g_blockFrames)
+		{
+			const auto frameCount = static_cast<size_t>(std::min<uint64_t>(g_blockFrames, result.frameCount - frame));
+			const auto sampleCount = frameCount * channels;
+
+			const auto* a = srcA + frame * frameSizeA;
+			const auto* b = srcB + frame * frameSizeB;
+
+			// fast path: identical data only needs to be decoded if the reference energy is required
+			if(sameFormat && memcmp(a, b, frameCount * frameSizeA) == 0)
+			{
+				if(needsReferenceEnergy)
+				{
+					decode(&bufB[0], b, sampleCount, _reference);
+
+					float sum = 0.0f;
+					for(size_t i=0; i<sampleCount; ++i)
+						sum += bufB[i] * bufB[i];
+					sumRef += sum;
+				}
+
+				if(diffWriter.isOpen())
+				{
+					std::fill_n(bufDiff.begin(), sampleCount, 0.0f);
+					diffWriter.write(&bufDiff[0], sampleCount * sizeof(float));
+				}
+				continue;
+			}
+
+			decode(&bufA[0], a, sampleCount, _data);
+			decode(&bufB[0], b, sampleCount, _reference);
+
+			float blockErr = 0.0f;
+			float blockRef = 0.0f;
+			float blockMax = 0.0f;
+
+			for(size_t i=0; i<sampleCount; ++i)
+			{
+				const auto d = bufA[i] - bufB[i];
+				bufDiff[i] = d;
+				blockErr += d * d;
+				blockRef += bufB[i] * bufB[i];
+				blockMax = std::max(blockMax, std::fabs(d));
+			}
+
+			sumErr += blockErr;
+			sumRef += blockRef;
+			maxErr = std::max(maxErr, blockMax);
+
+			if(missingFirstDifferences && blockMax > 0.0f)
+			{
+				for(size_t i=0; i<sampleCount; ++i)
+				{
+					if(bufDiff[i] == 0.0f)
+						continue;
+
+					auto& first = result.firstDifference[i % channels];
+					if(first >= 0)
+						continue;
+
+					first = static_cast<int64_t>(frame + i / channels);
+
+					if(!--missingFirstDifferences)
+						break;
+				}
+			}
+
+			if(diffWriter.isOpen())
+				diffWriter.write(&bufDiff[0], sampleCount * sizeof(float));
+		}
+
+		diffWriter.close();
+
+		const auto totalSamples = static_cast<double>(result.frameCount * channels);
+
+		result.maxAbsError = maxErr;
+		result.rmsError = totalSamples > 0 ? std::sqrt(sumErr / totalSamples) : 0.0;
+		result.rmsReference = totalSamples > 0 ? std::sqrt(sumRef / totalSamples) : 0.0;
+
+		// any error is infinitely large compared to a silent reference
+		if(result.rmsError > 0.0)
+			result.relativeDb = result.rmsReference > 0.0 ? 20.0 * std::log10(result.rmsError / result.rmsReference) : std::numeric_limits<double>::infinity();
+
+		if(result.frameCountA != result.frameCountB)
+		{
+			result.error = "Length mismatch, got " + std::to_string(result.frameCountA) + " frames but reference has " + std::to_string(result.frameCountB) + " frames";
+			return result;
+		}
+
+		switch (_options.mode)
+		{
+		case Mode::BitExact:
+			result.success = missingFirstDifferences == channels;
+			break;
+		case Mode::MaxAbsError:
+			result.success = result.maxAbsError <= _options.tolerance;
+			break;
+		case Mode::Rms:
+			result.success = result.rmsError <= _options.tolerance;
+			break;
+		case Mode::RelativeDb:
+			result.success = result.relativeDb <= _options.tolerance;
+			break;
+		}
+
+		return result;
+	}
+
+	bool AudioCompare::parseMode(Mode& _mode, const std::string& _name)
+	{
+		if(_name == "exact")		_mode = Mode::BitExact;
+		else if(_name == "maxabs")	_mode = Mode::MaxAbsError;
+		else if(_name == "rms")		_mode = Mode::Rms;
+		else if(_name == "db")		_mode = Mode::RelativeDb;
+		else return false;
+		return true;
+	}
+}
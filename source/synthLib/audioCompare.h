@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace synthLib
+{
+	struct Data;
+
+	// Compares two wave files, for example the output of a regression test with a reference file. Files are memory mapped and processed block by block
+	class AudioCompare
+	{
+	public:
+		enum class Mode
+		{
+			BitExact,		// all samples need to be identical
+			MaxAbsError,	// the absolute difference of each sample needs to be <= tolerance, in full scale units (1.0 = 0 dBFS)
+			Rms,			// the RMS of the difference needs to be <= tolerance, in full scale units
+			RelativeDb		// the RMS of the difference relative to the RMS of the reference, in dB, needs to be <= tolerance
+		};
+
+		struct Options
+		{
+			Mode mode = Mode::BitExact;
+			double tolerance = 0.0;
+			std::string diffFilename;	// if not empty, the difference is written to this file
+		};
+
+		struct Result
+		{
+			bool success = false;
+			std::string error;
+
+			uint64_t frameCount = 0;	// number of frames compared
+			uint64_t frameCountA = 0;
+			uint64_t frameCountB = 0;
+			uint32_t channels = 0;
+
+			std::vector<int64_t> firstDifference;	// first differing frame per channel, -1 if there is none
+
+			double maxAbsError = 0.0;
+			double rmsError = 0.0;
+			double rmsReference = 0.0;
+			double relativeDb = -200.0;
+		};
+
+		static Result compareFiles(const std::string& _filename, const std::string& _referenceFilename, const Options& _options);
+		static Result compare(const Data& _data, const Data& _reference, const Options& _options);
+
+		static bool parseMode(Mode& _mode, const std::string& _name);
+	};
+}
@@ -32,6 +32,8 @@ namespace synthLib
 		virtual uint32_t getChannelCountIn() = 0;
 		virtual uint32_t getChannelCountOut() = 0;
 
+		virtual bool sendParameterChange(const SParameterChange& _change) = 0;
+
 	protected:
 		virtual void readMidiOut(std::vector<SMidiEvent>& _midiOut) = 0;
 		virtual void processAudio(const TAudioInputs& _inputs, const TAudioOutputs& _outputs, size_t _samples) = 0;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace synthLib
 {
 	enum StateType
@@ -7,4 +9,14 @@ namespace synthLib
 		StateTypeGlobal,
 		StateTypeCurrentProgram,
 	};
+
+	// Parameter change that is sent to a device directly, without being wrapped into sysex
+	struct SParameterChange
+	{
+		uint8_t page = 0;
+		uint8_t part = 0;
+		uint8_t index = 0;
+		uint8_t value = 0;
+		uint32_t offset = 0;
+	};
 }
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace synthLib
+{
+	// 64 bit FNV-1a, not meant to be cryptographically secure
+	constexpr uint64_t g_hashSeed = 0xcbf29ce484222325ull;
+
+	inline uint64_t hash(const void* _data, const size_t _size, uint64_t _hash = g_hashSeed)
+	{
+		const auto* data = static_cast<const uint8_t*>(_data);
+
+		for(size_t i=0; i<_size; ++i)
+		{
+			_hash ^= data[i];
+			_hash *= 0x100000001b3ull;
+		}
+
+		return _hash;
+	}
+
+	template<typename T, typename = decltype(std::declval<const T&>().data())> uint64_t hash(const T& _container, const uint64_t _hash = g_hashSeed)
+	{
+		return hash(_container.data(), _container.size() * sizeof(typename T::value_type), _hash);
+	}
+}
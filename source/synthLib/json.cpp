@@ -0,0 +1,37 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace synthLib
+{
+	std::string escapeJson(const std::string& _s)
+	{
+		std::string res;
+		res.reserve(_s.size());
+
+		for (const char c : _s)
+		{
+			switch (c)
+			{
+			case '"':	res += "\\\"";	break;
+			case '\\':	res += "\\\\";	break;
+			case '\n':	res += "\\n";	break;
+			case '\r':	res += "\\r";	break;
+			case '\t':	res += "\\t";	break;
+			default:
+				if(static_cast<uint8_t>(c) < 0x20)
+				{
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					res += buf;
+				}
+				else
+				{
+					res += c;
+				}
+			}
+		}
+		return res;
+	}
+}
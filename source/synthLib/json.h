@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+namespace synthLib
+{
+	// escapes a string to be written as the content of a JSON string literal
+	std::string escapeJson(const std::string& _s);
+}
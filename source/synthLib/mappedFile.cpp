@@ -0,0 +1,127 @@
+#include "mappedFile.h"
+
+#include "dsp56kEmu/logging.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define NOSERVICE
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace synthLib
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string& _filename)
+	{
+		close();
+
+#ifdef _WIN32
+		std::wstring filename;
+		const int len = MultiByteToWideChar(CP_UTF8, 0, _filename.c_str(), static_cast<int>(_filename.size()), nullptr, 0);
+		if (len > 0)
+		{
+			filename.resize(len);
+			MultiByteToWideChar(CP_UTF8, 0, _filename.c_str(), static_cast<int>(_filename.size()), &filename[0], len);
+		}
+
+		const auto file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if(file == INVALID_HANDLE_VALUE)
+		{
+			LOG("Failed to open file " << _filename);
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		const auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if(!mapping)
+		{
+			LOG("Failed to map file " << _filename);
+			CloseHandle(file);
+			return false;
+		}
+
+		const auto* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if(!data)
+		{
+			LOG("Failed to map file " << _filename);
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = static_cast<size_t>(size.QuadPart);
+#else
+		const int fd = ::open(_filename.c_str(), O_RDONLY);
+
+		if(fd < 0)
+		{
+			LOG("Failed to open file " << _filename);
+			return false;
+		}
+
+		struct stat st{};
+		if(fstat(fd, &st) != 0 || st.st_size <= 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		auto* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(data == MAP_FAILED)
+		{
+			LOG("Failed to map file " << _filename);
+			::close(fd);
+			return false;
+		}
+
+		madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+		m_fd = fd;
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = static_cast<size_t>(st.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if(!m_data)
+			return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = nullptr;
+#else
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+		::close(m_fd);
+		m_fd = -1;
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
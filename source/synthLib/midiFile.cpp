@@ -0,0 +1,383 @@
+#include "midiFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "dsp56kEmu/logging.h"
+
+#ifdef _MSC_VER
+#include <string>
+#include <Windows.h>
+#endif
+
+namespace synthLib
+{
+	namespace
+	{
+#ifdef _MSC_VER
+		std::wstring ToUtf16(const std::string& str)
+		{
+			std::wstring ret;
+			const int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.size()), nullptr, 0);
+			if (len > 0)
+			{
+				ret.resize(len);
+				MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.size()), &ret[0], len);
+			}
+			return ret;
+		}
+#endif
+
+		uint32_t readBE(const uint8_t* _p, const size_t _numBytes)
+		{
+			uint32_t res = 0;
+			for(size_t i=0; i<_numBytes; ++i)
+				res = (res << 8) | _p[i];
+			return res;
+		}
+
+		bool readVarLen(uint32_t& _result, const std::vector<uint8_t>& _data, size_t& _pos, const size_t _end)
+		{
+			_result = 0;
+
+			// a variable length quantity has four bytes max
+			for(size_t i=0; i<4; ++i)
+			{
+				if(_pos >= _end)
+					return false;
+
+				const auto c = _data[_pos++];
+				_result = (_result << 7) | (c & 0x7f);
+
+				if(!(c & 0x80))
+					return true;
+			}
+			return false;
+		}
+	}
+
+	MidiFile::Iterator::Iterator(const MidiFile& _file, const float _samplerate) : m_file(_file), m_samplerate(_samplerate)
+	{
+		reset();
+	}
+
+	bool MidiFile::Iterator::next(Event& _event)
+	{
+		while(true)
+		{
+			TrackState* track = nullptr;
+			uint32_t trackIndex = 0;
+
+			for(size_t i=0; i<m_tracks.size(); ++i)
+			{
+				auto& t = m_tracks[i];
+				if(t.done)
+					continue;
+				if(track && t.tick >= track->tick)
+					continue;
+				track = &t;
+				trackIndex = static_cast<uint32_t>(i);
+			}
+
+			if(!track)
+				return false;
+
+			_event.track = trackIndex;
+			_event.tick = track->tick;
+
+			if(!readEvent(*track, _event))
+			{
+				LOG("Failed to read MIDI event in track " << trackIndex << " at offset " << track->pos);
+				track->done = true;
+				continue;
+			}
+
+			updateTime(_event);
+
+			if(_event.type == EventType::Meta && _event.a == 0x2f)
+				track->done = true;
+			else if(!readDelta(*track))
+				track->done = true;
+
+			return true;
+		}
+	}
+
+	void MidiFile::Iterator::reset()
+	{
+		m_tracks.clear();
+		m_tracks.reserve(m_file.m_tracks.size());
+
+		for (const auto& t : m_file.m_tracks)
+		{
+			TrackState& state = m_tracks.emplace_back();
+			state.pos = t.begin;
+			state.end = t.end;
+			state.done = !readDelta(state);
+		}
+
+		m_usPerQuarter = 500000;
+		m_tempoTick = 0;
+		m_tempoSeconds = 0.0;
+	}
+
+	bool MidiFile::Iterator::readDelta(TrackState& _track) const
+	{
+		uint32_t delta;
+		if(!readVarLen(delta, m_file.m_data, _track.pos, _track.end))
+			return false;
+		_track.tick += delta;
+		return true;
+	}
+
+	bool MidiFile::Iterator::readEvent(TrackState& _track, Event& _event) const
+	{
+		const auto& d = m_file.m_data;
+		auto& pos = _track.pos;
+		const auto end = _track.end;
+
+		if(pos >= end)
+			return false;
+
+		_event.data.clear();
+		_event.a = _event.b = _event.c = 0;
+
+		uint8_t status = d[pos];
+
+		switch (status)
+		{
+		case 0xf0:
+			{
+				++pos;
+				_track.runningStatus = 0;
+
+				uint32_t len;
+				if(!readVarLen(len, d, pos, end))
+					return false;
+
+				_event.type = EventType::Sysex;
+				_event.data.push_back(0xf0);
+
+				const auto* p = &d[0] + pos;
+
+				if(len > 0 && len <= end - pos && (p[len-1] == 0xf7 || p[len-1] == 0xf8))
+				{
+					_event.data.insert(_event.data.end(), p, p + len);
+					pos += len;
+				}
+				else
+				{
+					// some files do not have the length encoded properly, search for the end of the message instead
+					auto i = pos;
+					while(i < end && d[i] != 0xf7 && d[i] != 0xf8)
+						++i;
+
+					_event.data.insert(_event.data.end(), p, &d[0] + i);
+
+					if(i < end)
+					{
+						_event.data.push_back(0xf7);
+						++i;
+					}
+					pos = i;
+				}
+
+				// Virus Powercore writes f8 instead of f7
+				if(_event.data.back() == 0xf8)
+					_event.data.back() = 0xf7;
+			}
+			return true;
+		case 0xf7:
+			{
+				++pos;
+				_track.runningStatus = 0;
+
+				uint32_t len;
+				if(!readVarLen(len, d, pos, end) || len > end - pos)
+					return false;
+
+				_event.type = EventType::Escape;
+				_event.data.assign(d.begin() + static_cast<ptrdiff_t>(pos), d.begin() + static_cast<ptrdiff_t>(pos + len));
+				pos += len;
+			}
+			return true;
+		case 0xff:
+			{
+				++pos;
+				_track.runningStatus = 0;
+
+				if(pos >= end)
+					return false;
+
+				_event.type = EventType::Meta;
+				_event.a = d[pos++];
+
+				uint32_t len;
+				if(!readVarLen(len, d, pos, end) || len > end - pos)
+					return false;
+
+				_event.data.assign(d.begin() + static_cast<ptrdiff_t>(pos), d.begin() + static_cast<ptrdiff_t>(pos + len));
+				pos += len;
+			}
+			return true;
+		default:
+			break;
+		}
+
+		if(status & 0x80)
+		{
+			// system common and realtime messages are not allowed in a MIDI file
+			if(status >= 0xf0)
+				return false;
+
+			++pos;
+			_track.runningStatus = status;
+		}
+		else
+		{
+			status = _track.runningStatus;
+			if(!status)
+				return false;
+		}
+
+		const auto type = status & 0xf0;
+		const size_t len = (type == 0xc0 || type == 0xd0) ? 1 : 2;
+
+		if(len > end - pos)
+			return false;
+
+		_event.type = EventType::Channel;
+		_event.a = status;
+		_event.b = d[pos];
+		if(len > 1)
+			_event.c = d[pos+1];
+
+		pos += len;
+		return true;
+	}
+
+	void MidiFile::Iterator::updateTime(Event& _event)
+	{
+		const auto division = m_file.getDivision();
+
+		if(division & 0x8000)
+		{
+			// SMPTE time code, the tempo is fixed
+			const auto fps = -static_cast<int8_t>(division >> 8);
+			const auto framesPerSecond = fps == 29 ? 30000.0 / 1001.0 : static_cast<double>(fps);
+			const auto ticksPerFrame = static_cast<double>(division & 0xff);
+
+			_event.seconds = static_cast<double>(_event.tick) / (framesPerSecond * ticksPerFrame);
+		}
+		else
+		{
+			const auto ticks = static_cast<double>(_event.tick - m_tempoTick);
+			_event.seconds = m_tempoSeconds + ticks * static_cast<double>(m_usPerQuarter) / (1000000.0 * static_cast<double>(division));
+
+			if(_event.type == EventType::Meta && _event.a == 0x51 && _event.data.size() == 3)
+			{
+				m_usPerQuarter = readBE(&_event.data[0], 3);
+				m_tempoTick = _event.tick;
+				m_tempoSeconds = _event.seconds;
+			}
+		}
+
+		_event.sample = static_cast<uint64_t>(std::llround(_event.seconds * m_samplerate));
+	}
+
+	bool MidiFile::load(const char* _filename)
+	{
+		std::vector<uint8_t> data;
+		if(!readFile(data, _filename))
+			return false;
+		return load(std::move(data));
+	}
+
+	bool MidiFile::load(std::vector<uint8_t>&& _data)
+	{
+		m_data = std::move(_data);
+		return parse();
+	}
+
+	bool MidiFile::load(const uint8_t* _data, const size_t _size)
+	{
+		m_data.assign(_data, _data + _size);
+		return parse();
+	}
+
+	bool MidiFile::readFile(std::vector<uint8_t>& _data, const char* _filename)
+	{
+#ifdef _MSC_VER
+		FILE* hFile = _wfopen(ToUtf16(_filename).c_str(), L"rb");
+#else
+		FILE* hFile = fopen(_filename, "rb");
+#endif
+		if (hFile == nullptr)
+		{
+			LOG("Failed to open file " << _filename);
+			return false;
+		}
+
+		fseek(hFile, 0, SEEK_END);
+		const auto size = ftell(hFile);
+		fseek(hFile, 0, SEEK_SET);
+
+		if(size <= 0)
+		{
+			fclose(hFile);
+			return false;
+		}
+
+		_data.resize(static_cast<size_t>(size));
+		const auto numRead = fread(&_data[0], 1, _data.size(), hFile);
+		fclose(hFile);
+
+		if(numRead != _data.size())
+		{
+			LOG("Failed to read file " << _filename);
+			_data.clear();
+			return false;
+		}
+		return true;
+	}
+
+	bool MidiFile::parse()
+	{
+		m_tracks.clear();
+
+		const auto size = m_data.size();
+
+		if(size < 14 || memcmp(&m_data[0], "MThd", 4) != 0)
+			return false;
+
+		const auto headerLen = readBE(&m_data[4], 4);
+		if(headerLen < 6 || headerLen > size - 8)
+			return false;
+
+		m_format = static_cast<uint16_t>(readBE(&m_data[8], 2));
+		m_division = static_cast<uint16_t>(readBE(&m_data[12], 2));
+
+		if(!m_division)
+			return false;
+
+		size_t pos = 8 + headerLen;
+
+		while(pos + 8 <= size)
+		{
+			const auto* chunk = &m_data[pos];
+			const size_t len = readBE(chunk + 4, 4);
+			const auto begin = pos + 8;
+
+			// clamp truncated chunks to the file size
+			const auto end = len > size - begin ? size : begin + len;
+
+			if(memcmp(chunk, "MTrk", 4) == 0)
+				m_tracks.push_back({begin, end});
+
+			pos = end;
+		}
+
+		return !m_tracks.empty();
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace synthLib
+{
+	// Standard MIDI File reader. The whole file is read into memory at once, events are read on demand via an Iterator
+	class MidiFile
+	{
+	public:
+		enum class EventType
+		{
+			Channel,	// a, b, c contain the message, b and c are zero if the message is shorter
+			Sysex,		// data contains the full message including f0 and f7
+			Escape,		// f7 escape/continuation packet, data contains the raw payload
+			Meta		// a contains the meta type, data contains the payload
+		};
+
+		struct Event
+		{
+			EventType type = EventType::Channel;
+			uint32_t track = 0;
+			uint64_t tick = 0;
+			double seconds = 0.0;
+			uint64_t sample = 0;
+			uint8_t a = 0;
+			uint8_t b = 0;
+			uint8_t c = 0;
+			std::vector<uint8_t> data;
+		};
+
+		// Returns the events of all tracks merged, in order of their timestamps. Events with identical tick are returned in track order
+		class Iterator
+		{
+		public:
+			explicit Iterator(const MidiFile& _file, float _samplerate = 44100.0f);
+
+			bool next(Event& _event);
+			void reset();
+
+		private:
+			struct TrackState
+			{
+				size_t pos = 0;
+				size_t end = 0;
+				uint64_t tick = 0;
+				uint8_t runningStatus = 0;
+				bool done = false;
+			};
+
+			bool readDelta(TrackState& _track) const;
+			bool readEvent(TrackState& _track, Event& _event) const;
+			void updateTime(Event& _event);
+
+			const MidiFile& m_file;
+			const double m_samplerate;
+			std::vector<TrackState> m_tracks;
+
+			uint32_t m_usPerQuarter = 500000;
+			uint64_t m_tempoTick = 0;
+			double m_tempoSeconds = 0.0;
+		};
+
+		bool load(const char* _filename);
+		bool load(std::vector<uint8_t>&& _data);
+		bool load(const uint8_t* _data, size_t _size);
+
+		uint16_t getFormat() const { return m_format; }
+		uint16_t getDivision() const { return m_division; }
+		size_t getTrackCount() const { return m_tracks.size(); }
+
+		static bool readFile(std::vector<uint8_t>& _data, const char* _filename);
+
+	private:
+		bool parse();
+
+		struct Track
+		{
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		std::vector<uint8_t> m_data;
+		std::vector<Track> m_tracks;
+		uint16_t m_format = 0;
+		uint16_t m_division = 96;
+	};
+}
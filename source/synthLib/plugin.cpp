@@ -34,6 +34,18 @@ namespace synthLib
 		m_midiInRingBuffer.push_back(_ev);
 	}
 
+	void Plugin::addParameterChange(const SParameterChange& _change)
+	{
+		std::lock_guard lock(m_lockAddMidiEvent);
+
+		if(m_parameterChangeRingBuffer.full())
+		{
+			std::lock_guard lock(m_lock);
+			processParameterChange(m_parameterChangeRingBuffer.pop_front());
+		}
+		m_parameterChangeRingBuffer.push_back(_change);
+	}
+
 	void Plugin::setSamplerate(float _samplerate)
 	{
 		std::lock_guard lock(m_lock);
@@ -63,6 +75,7 @@ namespace synthLib
 		std::lock_guard lock(m_lock);
 
 		processMidiInEvents();
+		processParameterChanges();
 		processMidiClock(_bpm, _ppqPos, _isPlaying, _count);
 
 		m_resampler.process(inputs, outputs, m_midiIn, m_midiOut, static_cast<uint32_t>(_count), 
@@ -280,6 +293,25 @@ namespace synthLib
 		m_midiIn.push_back(_ev);
 	}
 
+	void Plugin::processParameterChanges()
+	{
+		while (!m_parameterChangeRingBuffer.empty())
+		{
+			const auto change = m_parameterChangeRingBuffer.pop_front();
+
+			processParameterChange(change);
+		}
+	}
+
+	void Plugin::processParameterChange(const SParameterChange& _change) const
+	{
+		// offsets are specified in host samples, the device expects them at its own samplerate
+		auto change = _change;
+		change.offset = static_cast<uint32_t>(static_cast<float>(_change.offset) * m_device->getSamplerate() * m_hostSamplerateInv);
+
+		m_device->sendParameterChange(change);
+	}
+
 	void Plugin::setBlockSize(const uint32_t _blockSize)
 	{
 		std::lock_guard lock(m_lock);
@@ -19,6 +19,7 @@ namespace synthLib
 		Plugin(Device* _device);
 
 		void addMidiEvent(const SMidiEvent& _ev);
+		void addParameterChange(const SParameterChange& _change);
 
 		void setSamplerate(float _samplerate);
 		void setBlockSize(uint32_t _blockSize);
@@ -45,8 +46,11 @@ namespace synthLib
 		void updateDeviceLatency();
 		void processMidiInEvents();
 		void processMidiInEvent(const SMidiEvent& _ev);
+		void processParameterChanges();
+		void processParameterChange(const SParameterChange& _change) const;
 
 		dsp56k::RingBuffer<SMidiEvent, 1024, false> m_midiInRingBuffer;
+		dsp56k::RingBuffer<SParameterChange, 1024, false> m_parameterChangeRingBuffer;
 		std::vector<SMidiEvent> m_midiIn;
 		std::vector<SMidiEvent> m_midiOut;
 
@@ -128,6 +128,9 @@ namespace synthLib
 
 		m_input.append(_inputs, _numSamples);
 
+		// device MIDI output offsets are relative to the device block they were generated in, make them relative to the start of this call
+		uint32_t deviceSampleOffset = 0;
+
 		auto feedInput = [&](TAudioOutputs& _data, uint32_t _numRequestedSamples)
 		{
 			const auto offset = _numRequestedSamples > m_input.size() ? _numRequestedSamples - m_input.size() : 0;
@@ -176,14 +179,19 @@ namespace synthLib
 				LOG("Resampler output latency " << m_outputLatency << " samples");
 			}
 			m_scaledInput.fillPointers(inputs);
+			const auto midiOutSize = m_midiOut.size();
 			_processFunc(inputs, _outs, _numProcessedSamples, m_processedMidiIn, m_midiOut);
+			for(size_t i=midiOutSize; i<m_midiOut.size(); ++i)
+				m_midiOut[i].offset += deviceSampleOffset;
+			deviceSampleOffset += _numProcessedSamples;
 			m_scaledInput.remove(_numProcessedSamples);
 			m_scaledInputSize -= _numProcessedSamples;
 		};
 
 		const auto outputSize = m_out->process(_outputs, m_channelCountOut, _numSamples, false, feedOutput);
 
-		scaleMidiEvents(_midiOut, m_midiOut, hostDivDev);
+		scaleMidiEvents(m_scaledMidiOut, m_midiOut, hostDivDev);
+		clampMidiEvents(_midiOut, m_scaledMidiOut, 0, _numSamples - 1);
 		m_midiOut.clear();
 	}
 }
@@ -48,6 +48,7 @@ namespace synthLib
 
 		TMidiVec m_midiIn;
 		TMidiVec m_midiOut;
+		TMidiVec m_scaledMidiOut;
 
 		uint32_t m_inputLatency = 0;
 		uint32_t m_outputLatency = 0;
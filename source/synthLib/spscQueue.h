@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace synthLib
+{
+	// Lock-free queue for exactly one producer and one consumer thread. Neither side ever blocks, push fails if the
+	// queue is full. pop swaps the item with the one passed in so that buffers of the consumer are recycled by the
+	// producer instead of being allocated again
+	template<typename T, size_t Capacity> class SpscQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "capacity needs to be a power of two");
+
+	public:
+		bool push(const T& _item)
+		{
+			const auto w = m_write.load(std::memory_order_relaxed);
+
+			if(w - m_read.load(std::memory_order_acquire) >= Capacity)
+				return false;
+
+			m_items[w & (Capacity - 1)] = _item;
+			m_write.store(w + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T& _item)
+		{
+			const auto r = m_read.load(std::memory_order_relaxed);
+
+			if(r == m_write.load(std::memory_order_acquire))
+				return false;
+
+			std::swap(_item, m_items[r & (Capacity - 1)]);
+			m_read.store(r + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool empty() const
+		{
+			return m_read.load(std::memory_order_acquire) == m_write.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::array<T, Capacity> m_items;
+		alignas(64) std::atomic<size_t> m_write = 0;
+		alignas(64) std::atomic<size_t> m_read = 0;
+	};
+}
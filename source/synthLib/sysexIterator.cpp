@@ -0,0 +1,58 @@
+#include "sysexIterator.h"
+
+namespace synthLib
+{
+	SysexIterator::SysexIterator(const uint8_t* _data, const size_t _size, const Validator _validator) : m_data(_data), m_size(_data ? _size : 0), m_validator(_validator)
+	{
+	}
+
+	SysexIterator::SysexIterator(const std::vector<uint8_t>& _data, const Validator _validator) : SysexIterator(_data.empty() ? nullptr : &_data.front(), _data.size(), _validator)
+	{
+	}
+
+	bool SysexIterator::next(SysexView& _message)
+	{
+		while(m_pos < m_size)
+		{
+			// search start of message
+			while(m_pos < m_size && m_data[m_pos] != 0xf0)
+				++m_pos;
+
+			if(m_pos >= m_size)
+				return false;
+
+			const auto begin = m_pos++;
+
+			// search end of message, any other status byte aborts it
+			while(m_pos < m_size && m_data[m_pos] < 0x80)
+				++m_pos;
+
+			if(m_pos >= m_size)
+			{
+				++m_invalidFramingCount;
+				return false;
+			}
+
+			if(m_data[m_pos] != 0xf7)
+			{
+				// do not skip the status byte, it might be the start of the next message
+				++m_invalidFramingCount;
+				continue;
+			}
+
+			++m_pos;
+
+			_message.data = m_data + begin;
+			_message.size = m_pos - begin;
+
+			if(m_validator && !m_validator(_message))
+			{
+				++m_invalidContentCount;
+				continue;
+			}
+
+			return true;
+		}
+		return false;
+	}
+}
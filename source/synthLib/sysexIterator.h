@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace synthLib
+{
+	// Non-owning view of a single sysex message inside a larger buffer, including f0 and f7
+	struct SysexView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		const uint8_t* begin() const { return data; }
+		const uint8_t* end() const { return data + size; }
+		uint8_t operator[](const size_t _index) const { return data[_index]; }
+		bool empty() const { return size == 0; }
+
+		std::vector<uint8_t> toVector() const { return {begin(), end()}; }
+	};
+
+	// Splits a buffer into sysex messages without copying them. Bytes outside of messages are skipped, messages
+	// that are interrupted by another status byte are dropped. An optional validator can be used to skip
+	// messages with invalid content, for example a wrong checksum
+	class SysexIterator
+	{
+	public:
+		using Validator = bool(*)(const SysexView& _message);
+
+		SysexIterator(const uint8_t* _data, size_t _size, Validator _validator = nullptr);
+		explicit SysexIterator(const std::vector<uint8_t>& _data, Validator _validator = nullptr);
+
+		bool next(SysexView& _message);
+
+		uint32_t getInvalidFramingCount() const { return m_invalidFramingCount; }
+		uint32_t getInvalidContentCount() const { return m_invalidContentCount; }
+
+	private:
+		const uint8_t* const m_data;
+		const size_t m_size;
+		const Validator m_validator;
+		size_t m_pos = 0;
+		uint32_t m_invalidFramingCount = 0;
+		uint32_t m_invalidContentCount = 0;
+	};
+}
@@ -22,9 +22,13 @@ bool WavReader::load(Data& _data, std::vector<CuePoint>* _cuePoints, const uint8
 	if( memcmp( header.str_wave, "WAVE", 4 ) != 0 )
 		return false;
 
-	if( memcmp( header.str_riff, "RIFF", 4 ) != 0 )
+	const bool isRF64 = memcmp( header.str_riff, "RF64", 4 ) == 0;
+
+	if( !isRF64 && memcmp( header.str_riff, "RIFF", 4 ) != 0 )
 		return false;
 
+	uint64_t dataSize64 = 0;
+
 	std::map<uint32_t, SWaveFormatChunkCuePoint> cuePoints;
 	std::map<uint32_t, std::string> labels;
 
@@ -41,10 +45,23 @@ bool WavReader::load(Data& _data, std::vector<CuePoint>* _cuePoints, const uint8
 		{
 			formatChunkOffset = bufferPos;
 		}
+		else if (isRF64 && memcmp(chunkInfo.chunkName, "ds64", 4) == 0 && chunkInfo.chunkSize >= sizeof(SWaveFormatChunkDs64))
+		{
+			const SWaveFormatChunkDs64& ds64 = *(SWaveFormatChunkDs64*)&_buffer[bufferPos];
+			dataSize64 = static_cast<uint64_t>(ds64.dataSizeHigh) << 32 | ds64.dataSizeLow;
+		}
 		else if (memcmp(chunkInfo.chunkName, "data", 4) == 0)
 		{
 			dataChunkOffset = bufferPos;
 			dataChunkSize = chunkInfo.chunkSize;
+
+			// in RF64 files, the real size is stored in the ds64 chunk
+			if(isRF64 && chunkInfo.chunkSize == 0xffffffff)
+			{
+				dataChunkSize = static_cast<size_t>(dataSize64);
+				bufferPos += (dataChunkSize + 1) & ~static_cast<size_t>(1);
+				continue;
+			}
 		}
 		else if (memcmp(chunkInfo.chunkName, "cue ", 4) == 0)
 		{
@@ -130,8 +147,12 @@ bool WavReader::load(Data& _data, std::vector<CuePoint>* _cuePoints, const uint8
 
 	bufferPos = dataChunkOffset;
 
-	const uint32_t numBytes			= static_cast<uint32_t>(dataChunkSize);
-	const uint32_t numSamples		= (numBytes << 3) / fmt.bits_per_sample;
+	// files that have not been finalized might have a data size that is too small or too large
+	if(dataChunkSize > _bufferSize - dataChunkOffset)
+		dataChunkSize = _bufferSize - dataChunkOffset;
+
+	const size_t numBytes			= dataChunkSize;
+	const size_t numSamples			= (numBytes << 3) / fmt.bits_per_sample;
 
 	int numChannels = fmt.num_channels;
 
@@ -32,6 +32,17 @@ namespace synthLib
 		uint16_t		bits_per_sample;		// bits per sample
 	};
 
+	struct SWaveFormatChunkDs64					// "ds64", size = 28 (0x1c), RF64 only
+	{
+		uint32_t		riffSizeLow;			// 64 bit RIFF size
+		uint32_t		riffSizeHigh;
+		uint32_t		dataSizeLow;			// 64 bit data chunk size
+		uint32_t		dataSizeHigh;
+		uint32_t		sampleCountLow;			// 64 bit number of frames
+		uint32_t		sampleCountHigh;
+		uint32_t		tableLength;			// number of entries in the size table that follows
+	};
+
 	struct SWaveFormatChunkCue
 	{
 		uint32_t		cuePointCount;			// number of cue points in list
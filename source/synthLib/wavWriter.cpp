@@ -2,8 +2,11 @@
 
 #include "../dsp56300/source/dsp56kEmu/logging.h"
 
-#include <map>
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <map>
 #include <chrono>
 #include <mutex>
 #include <thread>
@@ -12,93 +15,262 @@
 
 namespace synthLib
 {
-	bool WavWriter::write(const std::string & _filename, const int _bitsPerSample, const bool _isFloat, const int _channelCount, const int _samplerate, const void* _data, const size_t _dataSize)
+	constexpr size_t g_bufferSize = 1 << 20;
+	constexpr uint64_t g_checkpointInterval = 8 << 20;
+
+	constexpr size_t g_headerSize = sizeof(SWaveFormatHeader) +
+		sizeof(SWaveFormatChunkInfo) + sizeof(SWaveFormatChunkDs64) +
+		sizeof(SWaveFormatChunkInfo) + sizeof(SWaveFormatChunkFormat) +
+		sizeof(SWaveFormatChunkInfo);
+
+	static_assert(g_headerSize == 80, "unexpected wave header size");
+
+	WavWriter::~WavWriter()
 	{
-		FILE* handle = fopen(_filename.c_str(), m_existingDataSize > 0 ? "rb+" : "wb");
+		close();
+	}
+
+	bool WavWriter::open(const std::string& _filename, const int _bitsPerSample, const bool _isFloat, const int _channelCount, const int _samplerate)
+	{
+		close();
 
-		if (!handle)
+		m_handle = fopen(_filename.c_str(), "wb");
+
+		if (!m_handle)
 		{
 			LOG("Failed to open file for writing: " << _filename);
 			return false;
 		}
 
-		fseek(handle, 0, SEEK_END);
-		const auto currentSize = ftell(handle);
-		const bool append = currentSize > 0;
+		// we write large blocks ourselves, there is no need for another buffer in between
+		setvbuf(m_handle, nullptr, _IONBF, 0);
+
+		m_filename = _filename;
+		m_bitsPerSample = _bitsPerSample;
+		m_isFloat = _isFloat;
+		m_channelCount = _channelCount;
+		m_samplerate = _samplerate;
 
-		if(append)
+		m_dataSize = 0;
+		m_dataSizeAtCheckpoint = 0;
+		m_isRF64 = false;
+
+		m_buffer.reserve(g_bufferSize);
+		m_buffer.clear();
+
+		if(!writeHeader())
 		{
-			fwrite(_data, 1, _dataSize, handle);
-			fseek(handle, 0, SEEK_SET);
-			const auto pos = ftell(handle);
-			assert(pos == 0);
+			fclose(m_handle);
+			m_handle = nullptr;
+			return false;
 		}
+		return true;
+	}
 
-		m_existingDataSize += _dataSize;
+	bool WavWriter::write(const void* _data, const size_t _dataSize)
+	{
+		if(!m_handle)
+			return false;
+
+		const auto* d = static_cast<const uint8_t*>(_data);
+		m_buffer.insert(m_buffer.end(), d, d + _dataSize);
 
+		// if writing fails, the data stays in the buffer and is written with the next block
+		if(m_buffer.size() >= g_bufferSize)
+			writeBuffer();
+
+		return true;
+	}
+
+	bool WavWriter::writeSamples(const float* _samples, const size_t _count)
+	{
+		auto& buf = m_conversionBuffer;
+		buf.clear();
+
+		if(m_isFloat && m_bitsPerSample == 32)
+			return write(_samples, _count * sizeof(float));
+
+		if(m_isFloat)
+			return false;
+
+		switch (m_bitsPerSample)
+		{
+		case 16:
+			for(size_t i=0; i<_count; ++i)
+			{
+				const auto v = static_cast<int16_t>(std::clamp(_samples[i], -1.0f, 1.0f) * 32767.0f);
+				buf.push_back(static_cast<uint8_t>(v));
+				buf.push_back(static_cast<uint8_t>(v >> 8));
+			}
+			break;
+		case 24:
+			for(size_t i=0; i<_count; ++i)
+			{
+				const auto v = static_cast<int32_t>(std::clamp(_samples[i], -1.0f, 1.0f) * 8388607.0f);
+				buf.push_back(static_cast<uint8_t>(v));
+				buf.push_back(static_cast<uint8_t>(v >> 8));
+				buf.push_back(static_cast<uint8_t>(v >> 16));
+			}
+			break;
+		default:
+			return false;
+		}
+
+		return buf.empty() || write(&buf[0], buf.size());
+	}
+
+	bool WavWriter::flush()
+	{
+		if(!m_handle)
+			return false;
+
+		if(!writeBuffer())
+			return false;
+
+		if(m_dataSizeAtCheckpoint != m_dataSize && !writeHeader())
+			return false;
+
+		return fflush(m_handle) == 0;
+	}
+
+	bool WavWriter::close()
+	{
+		if(!m_handle)
+			return true;
+
+		bool res = writeBuffer();
+
+		// chunks need to be word aligned, the pad byte is not part of the data size
+		if(m_dataSize & 1)
+		{
+			constexpr uint8_t pad = 0;
+			fwrite(&pad, 1, 1, m_handle);
+		}
+
+		res &= writeHeader();
+		res &= fclose(m_handle) == 0;
+
+		m_handle = nullptr;
+		m_buffer.clear();
+
+		if(!res)
+			LOG("Failed to finalize file " << m_filename);
+
+		return res;
+	}
+
+	bool WavWriter::write(const std::string& _filename, const int _bitsPerSample, const bool _isFloat, const int _channelCount, const int _samplerate, const void* _data, const size_t _dataSize)
+	{
+		if(!m_handle && !open(_filename, _bitsPerSample, _isFloat, _channelCount, _samplerate))
+			return false;
+
+		return write(_data, _dataSize);
+	}
+
+	bool WavWriter::writeBuffer()
+	{
+		if(m_buffer.empty())
+			return true;
+
+		const auto written = fwrite(&m_buffer[0], 1, m_buffer.size(), m_handle);
+
+		m_dataSize += written;
+
+		if(written != m_buffer.size())
+		{
+			LOG("Failed to write " << m_buffer.size() << " bytes to file " << m_filename);
+			m_buffer.erase(m_buffer.begin(), m_buffer.begin() + static_cast<ptrdiff_t>(written));
+			return false;
+		}
+
+		m_buffer.clear();
+
+		if(m_dataSize - m_dataSizeAtCheckpoint >= g_checkpointInterval)
+			return writeHeader();
+
+		return true;
+	}
+
+	bool WavWriter::writeHeader()
+	{
 		SWaveFormatHeader header{};
-		SWaveFormatChunkInfo chunkInfo{};
+		SWaveFormatChunkInfo junkInfo{};
+		SWaveFormatChunkDs64 ds64{};
+		SWaveFormatChunkInfo fmtInfo{};
 		SWaveFormatChunkFormat fmt{};
+		SWaveFormatChunkInfo dataInfo{};
 
-		header.str_riff[0] = 'R';
-		header.str_riff[1] = 'I';
-		header.str_riff[2] = 'F';
-		header.str_riff[3] = 'F';
-
-		header.str_wave[0] = 'W';
-		header.str_wave[1] = 'A';
-		header.str_wave[2] = 'V';
-		header.str_wave[3] = 'E';
+		const uint64_t dataSize = m_dataSize;
+		const uint64_t riffSize = g_headerSize + ((dataSize + 1) & ~static_cast<uint64_t>(1)) - 8;
 
-		const size_t dataSize = m_existingDataSize;
+		// switch to RF64 once the sizes no longer fit into 32 bits. The ds64 chunk replaces the JUNK chunk that has been reserved for it
+		if(riffSize > 0xffffffff)
+			m_isRF64 = true;
 
-		header.file_size = static_cast<uint32_t>(sizeof(SWaveFormatHeader) +
-			sizeof(SWaveFormatChunkInfo) +
-			sizeof(SWaveFormatChunkFormat) +
-			sizeof(SWaveFormatChunkInfo) +
-			dataSize - 8);
+		const auto bytesPerSample = m_bitsPerSample >> 3;
+		const auto bytesPerFrame = bytesPerSample * m_channelCount;
 
-		fwrite(&header, 1, sizeof(header), handle);
-		const auto pos = ftell(handle);
-		assert(pos == sizeof(header));
+		memcpy(header.str_riff, m_isRF64 ? "RF64" : "RIFF", 4);
+		memcpy(header.str_wave, "WAVE", 4);
+		header.file_size = m_isRF64 ? 0xffffffff : static_cast<uint32_t>(riffSize);
 
-		// write format
-		chunkInfo.chunkName[0] = 'f';
-		chunkInfo.chunkName[1] = 'm';
-		chunkInfo.chunkName[2] = 't';
-		chunkInfo.chunkName[3] = ' ';
+		memcpy(junkInfo.chunkName, m_isRF64 ? "ds64" : "JUNK", 4);
+		junkInfo.chunkSize = sizeof(SWaveFormatChunkDs64);
 
-		chunkInfo.chunkSize = sizeof(SWaveFormatChunkFormat);
+		if(m_isRF64)
+		{
+			const uint64_t sampleCount = bytesPerFrame ? dataSize / bytesPerFrame : 0;
+
+			ds64.riffSizeLow = static_cast<uint32_t>(riffSize);
+			ds64.riffSizeHigh = static_cast<uint32_t>(riffSize >> 32);
+			ds64.dataSizeLow = static_cast<uint32_t>(dataSize);
+			ds64.dataSizeHigh = static_cast<uint32_t>(dataSize >> 32);
+			ds64.sampleCountLow = static_cast<uint32_t>(sampleCount);
+			ds64.sampleCountHigh = static_cast<uint32_t>(sampleCount >> 32);
+		}
 
-		fwrite(&chunkInfo, 1, sizeof(chunkInfo), handle);
+		memcpy(fmtInfo.chunkName, "fmt ", 4);
+		fmtInfo.chunkSize = sizeof(SWaveFormatChunkFormat);
 
-		const auto bytesPerSample = _bitsPerSample >> 3;
-		const auto bytesPerFrame = bytesPerSample * _channelCount;
+		fmt.bits_per_sample = static_cast<uint16_t>(m_bitsPerSample);
+		fmt.block_alignment = static_cast<uint16_t>(bytesPerFrame);
+		fmt.bytes_per_sec = static_cast<uint32_t>(m_samplerate * bytesPerFrame);
+		fmt.num_channels = static_cast<uint16_t>(m_channelCount);
+		fmt.sample_rate = static_cast<uint32_t>(m_samplerate);
+		fmt.wave_type = m_isFloat ? eFormat_IEEE_FLOAT : eFormat_PCM;
 
-		fmt.bits_per_sample = _bitsPerSample;
-		fmt.block_alignment = bytesPerFrame;
-		fmt.bytes_per_sec = _samplerate * bytesPerFrame;
-		fmt.num_channels = static_cast<uint16_t>(_channelCount);
-		fmt.sample_rate = static_cast<uint32_t>(_samplerate);
-		fmt.wave_type = _isFloat ? eFormat_IEEE_FLOAT : eFormat_PCM;
+		memcpy(dataInfo.chunkName, "data", 4);
+		dataInfo.chunkSize = m_isRF64 ? 0xffffffff : static_cast<uint32_t>(dataSize);
 
-		fwrite(&fmt, 1, sizeof(fmt), handle);
+		std::array<uint8_t, g_headerSize> buffer{};
+		size_t offset = 0;
 
-		// write data
-		chunkInfo.chunkName[0] = 'd';
-		chunkInfo.chunkName[1] = 'a';
-		chunkInfo.chunkName[2] = 't';
-		chunkInfo.chunkName[3] = 'a';
+		auto append = [&](const auto& _chunk)
+		{
+			memcpy(&buffer[offset], &_chunk, sizeof(_chunk));
+			offset += sizeof(_chunk);
+		};
 
-		chunkInfo.chunkSize = static_cast<unsigned int>(m_existingDataSize);
+		append(header);
+		append(junkInfo);
+		append(ds64);
+		append(fmtInfo);
+		append(fmt);
+		append(dataInfo);
 
-		fwrite(&chunkInfo, 1, sizeof(chunkInfo), handle);
+		assert(offset == g_headerSize);
 
-		if(!append)
-			fwrite(_data, 1, m_existingDataSize, handle);
+		fseek(m_handle, 0, SEEK_SET);
+		const auto written = fwrite(&buffer[0], 1, buffer.size(), m_handle);
+		fseek(m_handle, 0, SEEK_END);
 
-		fclose(handle);
+		if(written != buffer.size())
+		{
+			LOG("Failed to write wave header to file " << m_filename);
+			return false;
+		}
 
+		m_dataSizeAtCheckpoint = dataSize;
 		return true;
 	}
 
@@ -110,11 +282,21 @@ namespace synthLib
 		_dst.push_back(d[2]);
 	}
 
-	AsyncWriter::AsyncWriter(std::string _filename, uint32_t _samplerate, bool _measureSilence)
+	void WavWriter::writeFloat(std::vector<uint8_t>& _dst, const float _value)
+	{
+		const auto d = reinterpret_cast<const uint8_t*>(&_value);
+		_dst.insert(_dst.end(), d, d + sizeof(float));
+	}
+
+	AsyncWriter::AsyncWriter(std::string _filename, uint32_t _samplerate, bool _measureSilence, uint32_t _channelCount, bool _isFloat)
 	: m_filename(std::move(_filename))
 	, m_samplerate(_samplerate)
 	, m_measureSilence(_measureSilence)
+	, m_channelCount(_channelCount)
+	, m_isFloat(_isFloat)
 	{
+		m_ring.resize(RingFrames * m_channelCount);
+
 		m_thread.reset(new std::thread([&]()
 		{
 			threadWriteFunc();
@@ -123,7 +305,7 @@ namespace synthLib
 
 	AsyncWriter::~AsyncWriter()
 	{
-		m_finished = true;
+		setFinished();
 
 		if(m_thread)
 		{
@@ -132,80 +314,198 @@ namespace synthLib
 		}
 	}
 
-	void AsyncWriter::append(const std::function<void(std::vector<dsp56k::TWord>&)>& _func)
+	void AsyncWriter::append(const dsp56k::TWord* _left, const dsp56k::TWord* _right, const size_t _frameCount)
 	{
-		std::lock_guard lock(m_writeMutex);
-		_func(m_stereoOutput);
+		assert(m_channelCount == 2);
+		const dsp56k::TWord* channels[] = {_left, _right};
+		append(channels, _frameCount);
 	}
 
-	void AsyncWriter::threadWriteFunc()
+	void AsyncWriter::append(const dsp56k::TWord* const* _channels, const size_t _frameCount)
 	{
-		synthLib::WavWriter writer;
+		constexpr size_t mask = RingFrames - 1;
+		constexpr size_t wakeupThreshold = RingFrames >> 3;
 
-		std::vector<dsp56k::TWord> m_wordBuffer;
-		std::vector<uint8_t> m_byteBuffer;
-		m_byteBuffer.reserve(m_wordBuffer.capacity() * 3);
+		const auto channelCount = m_channelCount;
 
-		bool foundNonSilence = false;
+		size_t frame = 0;
 
-		while(true)
+		while(frame < _frameCount)
 		{
+			const auto writePos = m_writePos.load(std::memory_order_relaxed);
+			const auto readPos = m_readPos.load(std::memory_order_acquire);
+
+			if(writePos - readPos >= RingFrames)
 			{
-				std::lock_guard lock(m_writeMutex);
-				std::swap(m_wordBuffer, m_stereoOutput);
+				// the writer fell behind, wait until it has made some space
+				std::unique_lock lock(m_wakeMutex);
+				m_producerWaiting = true;
+				m_cvData.notify_one();
+				m_cvSpace.wait_for(lock, std::chrono::milliseconds(10), [&]
+				{
+					return m_writePos.load(std::memory_order_relaxed) - m_readPos.load(std::memory_order_acquire) < RingFrames;
+				});
+				m_producerWaiting = false;
+				continue;
 			}
 
-			if(m_wordBuffer.empty() && m_byteBuffer.empty() && m_finished)
-				break;
+			const auto frameCount = std::min(_frameCount - frame, RingFrames - (writePos - readPos));
 
-			if(!m_wordBuffer.empty())
+			auto* dst = &m_ring[0];
+			auto pos = writePos;
+
+			for(size_t i=0; i<frameCount; ++i, ++frame, ++pos)
 			{
-				for (const dsp56k::TWord w : m_wordBuffer)
-					WavWriter::writeWord(m_byteBuffer, w);
+				auto* d = dst + (pos & mask) * channelCount;
+				for(size_t c=0; c<channelCount; ++c)
+					d[c] = _channels[c][frame];
+			}
 
-				if(m_measureSilence)
-				{
-					bool isSilence = true;
-
-					for (const dsp56k::TWord w : m_wordBuffer)
-					{
-						constexpr dsp56k::TWord silenceThreshold = 0x1ff;
-						const bool silence = w < silenceThreshold || w >= (0xffffff - silenceThreshold);
-						if(!silence)
-						{
-							isSilence = false;
-							break;
-						}
-					}
-
-					if(foundNonSilence && isSilence)
-					{
-						m_silenceDuration += static_cast<uint32_t>(m_wordBuffer.size() >> 1);
-					}
-					else if(!isSilence)
-					{
-						m_silenceDuration = 0;
-						foundNonSilence = true;
-					}
-				}
+			m_writePos.store(pos, std::memory_order_release);
+
+			const auto usedBefore = writePos - readPos;
+			const auto usedAfter = pos - readPos;
 
-				m_wordBuffer.clear();
+			if(usedBefore < wakeupThreshold && usedAfter >= wakeupThreshold)
+				m_cvData.notify_one();
+		}
+	}
+
+	void AsyncWriter::setFinished()
+	{
+		m_finished = true;
+		m_cvData.notify_one();
+	}
+
+	void AsyncWriter::threadWriteFunc()
+	{
+		WavWriter writer;
+
+		std::vector<uint8_t> byteBuffer;
+
+		while(true)
+		{
+			if(process(writer, byteBuffer))
+				continue;
+
+			if(m_finished)
+			{
+				// the producer might have written more data before it set the finished flag
+				if(!process(writer, byteBuffer))
+					break;
+				continue;
 			}
 
-			if(!m_byteBuffer.empty())
+			std::unique_lock lock(m_wakeMutex);
+
+			m_cvData.wait_for(lock, std::chrono::milliseconds(100), [&]
 			{
-				if(writer.write(m_filename, 24, false, 2, static_cast<int>(m_samplerate), &m_byteBuffer[0], m_byteBuffer.size()))
+				return m_finished || m_producerWaiting || m_writePos.load(std::memory_order_acquire) - m_readPos.load(std::memory_order_relaxed) >= (RingFrames >> 3);
+			});
+		}
+
+		writer.close();
+	}
+
+	size_t AsyncWriter::process(WavWriter& _writer, std::vector<uint8_t>& _byteBuffer)
+	{
+		constexpr size_t mask = RingFrames - 1;
+
+		const auto readPos = m_readPos.load(std::memory_order_relaxed);
+		const auto writePos = m_writePos.load(std::memory_order_acquire);
+
+		if(readPos == writePos)
+			return 0;
+
+		const auto frameCount = writePos - readPos;
+		const auto channelCount = m_channelCount;
+		const auto wordCount = frameCount * channelCount;
+		const auto bytesPerWord = m_isFloat ? sizeof(float) : 3;
+
+		_byteBuffer.resize(wordCount * bytesPerWord);
+
+		// convert and measure peak and silence in one pass
+		constexpr int32_t silenceThreshold = 0x1ff;
+
+		int32_t peak = 0;
+		size_t lastNonSilence = wordCount;
+
+		auto* dst = &_byteBuffer[0];
+
+		// the ring content is processed in at most two contiguous segments
+		for(size_t offset = 0; offset < frameCount;)
+		{
+			const auto begin = (readPos + offset) & mask;
+			const auto segmentSize = std::min(frameCount - offset, RingFrames - begin) * channelCount;
+			const auto* src = &m_ring[begin * channelCount];
+			const auto segmentOffset = offset * channelCount;
+
+			if(m_isFloat)
+			{
+				for(size_t i=0; i<segmentSize; ++i)
 				{
-					m_byteBuffer.clear();
+					const auto v = static_cast<int32_t>(src[i] << 8) >> 8;
+
+					const auto f = static_cast<float>(v) * (1.0f / 8388608.0f);
+					memcpy(dst, &f, sizeof(f));
+					dst += sizeof(f);
+
+					peak = std::max(peak, v < 0 ? -v : v);
+
+					if(v >= silenceThreshold || v < -silenceThreshold-1)
+						lastNonSilence = segmentOffset + i;
 				}
-				else if(m_finished)
+			}
+			else
+			{
+				for(size_t i=0; i<segmentSize; ++i)
 				{
-					LOG("Unable to write data to file " << m_filename << " but termination requested, file is missing data");
-					break;
+					const auto w = src[i];
+
+					dst[0] = static_cast<uint8_t>(w);
+					dst[1] = static_cast<uint8_t>(w >> 8);
+					dst[2] = static_cast<uint8_t>(w >> 16);
+					dst += 3;
+
+					const auto v = static_cast<int32_t>(w << 8) >> 8;
+
+					peak = std::max(peak, v < 0 ? -v : v);
+
+					if(v >= silenceThreshold || v < -silenceThreshold-1)
+						lastNonSilence = segmentOffset + i;
 				}
 			}
 
-			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			offset += segmentSize / channelCount;
 		}
+
+		m_readPos.store(writePos, std::memory_order_release);
+
+		if(m_producerWaiting)
+		{
+			std::lock_guard lock(m_wakeMutex);
+			m_cvSpace.notify_one();
+		}
+
+		if(static_cast<uint32_t>(peak) > m_peak)
+			m_peak = static_cast<uint32_t>(peak);
+
+		if(m_measureSilence)
+		{
+			if(lastNonSilence < wordCount)
+			{
+				m_foundNonSilence = true;
+				m_silenceDuration = static_cast<uint32_t>(frameCount - 1 - lastNonSilence / channelCount);
+			}
+			else if(m_foundNonSilence)
+			{
+				m_silenceDuration += static_cast<uint32_t>(frameCount);
+			}
+		}
+
+		if(!_writer.write(m_filename, m_isFloat ? 32 : 24, m_isFloat, static_cast<int>(channelCount), static_cast<int>(m_samplerate), &_byteBuffer[0], _byteBuffer.size()))
+			LOG("Unable to write data to file " << m_filename << ", file is missing data");
+
+		return frameCount;
 	}
 }
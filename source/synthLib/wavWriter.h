@@ -1,6 +1,8 @@
 #pragma once
 
-#include <functional>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
 #include <memory>
 #include <mutex>
 
@@ -14,35 +16,71 @@
 
 namespace synthLib
 {
+	// Streaming wave file writer. The file stays open while writing, data is written in large blocks and the header
+	// sizes are patched at regular checkpoints and on close. Files that grow beyond 4 GB are converted to RF64
 	class WavWriter
 	{
 	public:
+		WavWriter() = default;
+		WavWriter(const WavWriter&) = delete;
+		WavWriter& operator = (const WavWriter&) = delete;
+		~WavWriter();
+
+		bool open(const std::string& _filename, int _bitsPerSample, bool _isFloat, int _channelCount, int _samplerate);
+		bool write(const void* _data, size_t _dataSize);
+		bool writeSamples(const float* _samples, size_t _count);
+		bool flush();
+		bool close();
+
+		bool isOpen() const { return m_handle != nullptr; }
+		uint64_t getDataSize() const { return m_dataSize; }
+
+		// opens the file on first use, all further calls append to it
 		bool write(const std::string& _filename, int _bitsPerSample, bool isFloat, int _channelCount, int _samplerate, const void* _data, size_t _dataSize);
 
 		template<typename T>
 		bool write(const std::string& _filename, int _bitsPerSample, bool isFloat, int _channelCount, int _samplerate, const std::vector<T>& _data)
 		{
+			if(_data.empty())
+				return true;
 			return write(_filename, _bitsPerSample, isFloat, _channelCount, _samplerate, &_data[0], sizeof(T) * _data.size());
 		}
 
 		static void writeWord(std::vector<uint8_t>& _dst, dsp56k::TWord _word);
+		static void writeFloat(std::vector<uint8_t>& _dst, float _value);
 
 	private:
-		size_t m_existingDataSize = 0;
+		bool writeBuffer();
+		bool writeHeader();
+
+		FILE* m_handle = nullptr;
+		std::string m_filename;
+		std::vector<uint8_t> m_buffer;
+		std::vector<uint8_t> m_conversionBuffer;
+
+		int m_bitsPerSample = 0;
+		bool m_isFloat = false;
+		int m_channelCount = 0;
+		int m_samplerate = 0;
+
+		uint64_t m_dataSize = 0;
+		uint64_t m_dataSizeAtCheckpoint = 0;
+		bool m_isRF64 = false;
 	};
 
+	// Writes 24 bit audio to a wave file on a separate thread, either as 24 bit PCM or as 32 bit float. The render thread hands
+	// data over via a single producer/single consumer ring buffer and only blocks if the writer falls behind by more than the ring size
 	class AsyncWriter
 	{
 	public:
-		AsyncWriter(std::string _filename, uint32_t _samplerate, bool _measureSilence = false);
+		AsyncWriter(std::string _filename, uint32_t _samplerate, bool _measureSilence = false, uint32_t _channelCount = 2, bool _isFloat = false);
 		~AsyncWriter();
 
-		void append(const std::function<void(std::vector<dsp56k::TWord>&)>& _func);
+		// must only be called from one thread. Expects one pointer per channel
+		void append(const dsp56k::TWord* const* _channels, size_t _frameCount);
+		void append(const dsp56k::TWord* _left, const dsp56k::TWord* _right, size_t _frameCount);
 
-		void setFinished()
-		{
-			m_finished = true;
-		}
+		void setFinished();
 
 		bool isFinished() const
 		{
@@ -54,17 +92,43 @@ namespace synthLib
 			return m_silenceDuration;
 		}
 
+		// peak absolute sample value written so far, 24 bit range
+		uint32_t getPeak() const
+		{
+			return m_peak;
+		}
+
+		uint32_t getChannelCount() const
+		{
+			return m_channelCount;
+		}
+
 	private:
 		void threadWriteFunc();
+		size_t process(WavWriter& _writer, std::vector<uint8_t>& _byteBuffer);
+
+		static constexpr size_t RingFrames = 1 << 19;	// needs to be a power of two
 
 		const std::string m_filename;
 		const uint32_t m_samplerate;
 		const bool m_measureSilence;
+		const uint32_t m_channelCount;
+		const bool m_isFloat;
+
+		std::atomic<bool> m_finished = false;
+		std::atomic<uint32_t> m_silenceDuration = 0;
+		std::atomic<uint32_t> m_peak = 0;
+		bool m_foundNonSilence = false;
+
+		std::vector<dsp56k::TWord> m_ring;
+		std::atomic<size_t> m_readPos = 0;		// in frames
+		std::atomic<size_t> m_writePos = 0;		// in frames
+		std::atomic<bool> m_producerWaiting = false;
+
+		std::mutex m_wakeMutex;
+		std::condition_variable m_cvData;
+		std::condition_variable m_cvSpace;
 
-		bool m_finished = false;
 		std::unique_ptr<std::thread> m_thread;
-		uint32_t m_silenceDuration = 0;
-		std::mutex m_writeMutex;
-		std::vector<dsp56k::TWord> m_stereoOutput;
 	};
 };
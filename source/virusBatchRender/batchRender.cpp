@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "batchRenderer.h"
+
+#include "../dsp56300/source/disassemble/commandline.h"
+
+namespace
+{
+	void printUsage()
+	{
+		std::cout << "Usage:" << std::endl;
+		std::cout << "  virusBatchRender -jobs joblist.txt [options]" << std::endl;
+		std::cout << "  virusBatchRender -rom file.bin -preset name|number|file.syx [-midi file.mid] [-seconds n] -out file.wav [options]" << std::endl;
+		std::cout << "The job list contains one job per line: rom;preset;midi file;seconds;output file" << std::endl;
+		std::cout << "Options: -threads n -samplerate n -blocksize n -preroll seconds -tail seconds -float" << std::endl;
+	}
+}
+
+int main(int _argc, char* _argv[])
+{
+	try
+	{
+		const CommandLine cmd(_argc, _argv);
+
+		BatchRenderer::Options options;
+
+		if(cmd.contains("samplerate"))	options.samplerate = std::stof(cmd.get("samplerate"));
+		if(cmd.contains("blocksize"))	options.blockSize = static_cast<uint32_t>(std::max(1, cmd.getInt("blocksize")));
+		if(cmd.contains("preroll"))		options.prerollSeconds = std::stof(cmd.get("preroll"));
+		if(cmd.contains("tail"))		options.tailSeconds = std::stof(cmd.get("tail"));
+		if(cmd.contains("float"))		options.isFloat = true;
+
+		BatchRenderer renderer(options);
+
+		if(cmd.contains("jobs"))
+		{
+			if(!renderer.addJobs(cmd.get("jobs")))
+				return -1;
+		}
+		else if(cmd.contains("rom") && cmd.contains("preset") && cmd.contains("out"))
+		{
+			BatchRenderer::Job job;
+			job.romFile = cmd.get("rom");
+			job.preset = cmd.get("preset");
+			job.midiFile = cmd.contains("midi") ? cmd.get("midi") : std::string();
+			job.seconds = cmd.contains("seconds") ? std::stof(cmd.get("seconds")) : 0.0f;
+			job.outputFile = cmd.get("out");
+			renderer.add(job);
+		}
+		else
+		{
+			printUsage();
+			return -1;
+		}
+
+		if(renderer.getJobs().empty())
+		{
+			std::cout << "Nothing to render" << std::endl;
+			return -1;
+		}
+
+		const auto threadCount = cmd.contains("threads") ? cmd.getInt("threads") : static_cast<int>(std::thread::hardware_concurrency());
+
+		return renderer.run(static_cast<uint32_t>(std::max(1, threadCount)));
+	}
+	catch(const std::runtime_error& _err)
+	{
+		std::cout << _err.what() << std::endl;
+		return -1;
+	}
+	catch(const std::logic_error& _err)
+	{
+		std::cout << "Invalid command line argument: " << _err.what() << std::endl;
+		return -1;
+	}
+}
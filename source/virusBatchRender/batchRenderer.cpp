@@ -0,0 +1,221 @@
+#include "batchRenderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "../synthLib/os.h"
+#include "../synthLib/wavWriter.h"
+
+#include "../virusConsoleLib/renderEngine.h"
+
+BatchRenderer::BatchRenderer(const Options& _options) : m_options(_options)
+{
+}
+
+BatchRenderer::~BatchRenderer() = default;
+
+void BatchRenderer::add(const Job& _job)
+{
+	m_jobs.push_back(_job);
+}
+
+bool BatchRenderer::addJobs(const std::string& _jobListFile)
+{
+	std::ifstream f(_jobListFile, std::ios::in);
+
+	if(!f.is_open())
+	{
+		std::cout << "Failed to open job list " << _jobListFile << std::endl;
+		return false;
+	}
+
+	std::string line;
+	uint32_t lineNumber = 0;
+
+	while(std::getline(f, line))
+	{
+		++lineNumber;
+
+		while(!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+			line.pop_back();
+
+		if(line.empty() || line.front() == '#')
+			continue;
+
+		std::vector<std::string> fields;
+		std::stringstream ss(line);
+		std::string field;
+
+		while(std::getline(ss, field, ';'))
+			fields.push_back(field);
+
+		if(fields.size() != 5)
+		{
+			std::cout << _jobListFile << '(' << lineNumber << "): expected 5 fields rom;preset;midi;seconds;output but got " << fields.size() << std::endl;
+			return false;
+		}
+
+		Job job;
+		job.romFile = fields[0];
+		job.preset = fields[1];
+		job.midiFile = fields[2];
+		job.seconds = fields[3].empty() ? 0.0f : std::strtof(fields[3].c_str(), nullptr);
+		job.outputFile = fields[4];
+
+		if(job.romFile.empty() || job.preset.empty() || job.outputFile.empty())
+		{
+			std::cout << _jobListFile << '(' << lineNumber << "): ROM, preset and output file must not be empty" << std::endl;
+			return false;
+		}
+
+		m_jobs.emplace_back(std::move(job));
+	}
+
+	return true;
+}
+
+int BatchRenderer::run(const uint32_t _threadCount)
+{
+	const auto tStart = std::chrono::steady_clock::now();
+
+	for (auto& job : m_jobs)
+	{
+		auto& rom = m_roms[job.romFile];
+		if(!rom)
+			rom.reset(new virusLib::ROMFile(job.romFile));
+	}
+
+	const auto threadCount = std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(_threadCount), m_jobs.size()));
+
+	std::cout << "Rendering " << m_jobs.size() << " jobs on " << threadCount << " threads" << std::endl;
+
+	std::atomic<size_t> nextJob = 0;
+
+	auto threadFunc = [&]()
+	{
+		// booted devices of this thread, one per ROM
+		std::map<std::string, std::unique_ptr<RenderEngine>> engines;
+
+		while(true)
+		{
+			const auto index = nextJob++;
+			if(index >= m_jobs.size())
+				break;
+			renderJob(engines, m_jobs[index]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+
+	for(size_t i=0; i<threadCount; ++i)
+		threads.emplace_back(threadFunc);
+
+	for (auto& t : threads)
+		t.join();
+
+	const auto totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+	uint32_t failCount = 0;
+
+	for (const auto& job : m_jobs)
+	{
+		if(job.success)
+			continue;
+
+		++failCount;
+		std::cout << "FAILED  " << job.outputFile << ": " << job.error << std::endl;
+	}
+
+	std::cout << m_jobs.size() - failCount << " of " << m_jobs.size() << " jobs rendered in " << totalSeconds << "s" << std::endl;
+
+	return failCount ? -1 : 0;
+}
+
+void BatchRenderer::renderJob(std::map<std::string, std::unique_ptr<RenderEngine>>& _engines, Job& _job) const
+{
+	const auto tStart = std::chrono::steady_clock::now();
+
+	const auto& rom = *m_roms.find(_job.romFile)->second;
+
+	if(!rom.isValid())
+	{
+		_job.error = "failed to load ROM " + _job.romFile;
+		return;
+	}
+
+	virusLib::ROMFile::TPreset single;
+
+	const bool isSysex = synthLib::hasExtension(_job.preset, ".syx");
+
+	if(isSysex ? !RenderEngine::getSingleFromSysexFile(single, _job.preset) : !RenderEngine::findSingle(single, rom, _job.preset))
+	{
+		_job.error = "failed to find preset " + _job.preset;
+		return;
+	}
+
+	std::vector<synthLib::SMidiEvent> events;
+	uint64_t lastSample = 0;
+
+	if(!_job.midiFile.empty() && !RenderEngine::readMidiFile(events, lastSample, _job.midiFile, m_options.samplerate))
+	{
+		_job.error = "failed to load MIDI file " + _job.midiFile;
+		return;
+	}
+
+	const auto sampleCount = _job.seconds > 0.0f
+		? static_cast<uint64_t>(static_cast<double>(_job.seconds) * m_options.samplerate)
+		: lastSample + static_cast<uint64_t>(m_options.tailSeconds * m_options.samplerate);
+
+	try
+	{
+		auto& engine = _engines[_job.romFile];
+
+		if(!engine)
+		{
+			RenderEngine::Options options;
+			options.samplerate = m_options.samplerate;
+			options.blockSize = m_options.blockSize;
+			options.prerollSeconds = m_options.prerollSeconds;
+
+			engine.reset(new RenderEngine(rom, options));
+		}
+
+		synthLib::WavWriter writer;
+
+		if(!writer.open(_job.outputFile, m_options.isFloat ? 32 : 24, m_options.isFloat, 2, static_cast<int>(m_options.samplerate)))
+		{
+			_job.error = "failed to create output file " + _job.outputFile;
+			return;
+		}
+
+		engine->loadSingle(single);
+
+		const auto res = engine->render(sampleCount, events, [&](const float* _interleaved, const size_t _frameCount)
+		{
+			return writer.writeSamples(_interleaved, _frameCount << 1);
+		});
+
+		if(!writer.close() || !res)
+			_job.error = "failed to write to output file " + _job.outputFile;
+		else
+			_job.success = true;
+	}
+	catch(const std::runtime_error& _err)
+	{
+		_job.error = _err.what();
+		_job.success = false;
+	}
+
+	_job.renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+	if(_job.success)
+		std::cout << "OK      " << _job.outputFile << " (" << _job.renderSeconds << "s)" << std::endl;
+}
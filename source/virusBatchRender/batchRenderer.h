@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class RenderEngine;
+
+namespace virusLib
+{
+	class ROMFile;
+}
+
+// Renders a list of jobs, each consisting of a ROM, a preset, a MIDI file and a duration, to wave files. Jobs are
+// distributed across multiple threads, every thread keeps its booted devices and reuses them for all further jobs
+class BatchRenderer
+{
+public:
+	struct Options
+	{
+		float samplerate = 48000.0f;
+		uint32_t blockSize = 512;
+		float prerollSeconds = 1.0f;	// rendered and discarded after loading a preset, gives the device time to load it and lets tails of the previous job fade out
+		float tailSeconds = 2.0f;		// appended to the MIDI file length if a job has no duration
+		bool isFloat = false;
+	};
+
+	struct Job
+	{
+		std::string romFile;
+		std::string preset;		// preset name, preset number or .syx file
+		std::string midiFile;	// may be empty
+		float seconds = 0.0f;	// if zero, the length of the MIDI file plus the tail length
+		std::string outputFile;
+
+		bool success = false;
+		std::string error;
+		double renderSeconds = 0.0;
+	};
+
+	explicit BatchRenderer(const Options& _options);
+	~BatchRenderer();
+
+	void add(const Job& _job);
+
+	// reads a job list. One job per line, fields are separated by ';': rom;preset;midi file;seconds;output file. Lines starting with # are ignored
+	bool addJobs(const std::string& _jobListFile);
+
+	int run(uint32_t _threadCount);
+
+	const std::vector<Job>& getJobs() const { return m_jobs; }
+
+private:
+	void renderJob(std::map<std::string, std::unique_ptr<RenderEngine>>& _engines, Job& _job) const;
+
+	const Options m_options;
+	std::vector<Job> m_jobs;
+	std::map<std::string, std::unique_ptr<virusLib::ROMFile>> m_roms;
+};
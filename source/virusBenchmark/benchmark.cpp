@@ -0,0 +1,577 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "../synthLib/json.h"
+#include "../synthLib/plugin.h"
+
+#include "../virusLib/device.h"
+#include "../virusLib/microcontroller.h"
+#include "../virusLib/romfile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	constexpr float g_hostSamplerates[] = {44100.0f, 48000.0f, 96000.0f};
+
+	// number of automation messages sent per block in the storm scenarios
+	constexpr uint32_t g_stormMessagesPerBlock = 16;
+
+	// Parses the key/value pairs of a JSON object that does not contain nested objects or arrays, as written by Benchmark::writeJson
+	void parseFlatObject(std::map<std::string, std::string>& _values, const std::string& _object)
+	{
+		size_t pos = 0;
+
+		auto readString = [&](std::string& _result)
+		{
+			_result.clear();
+			for(++pos; pos < _object.size() && _object[pos] != '"'; ++pos)
+			{
+				if(_object[pos] == '\\' && pos + 1 < _object.size())
+					++pos;
+				_result += _object[pos];
+			}
+			++pos;
+		};
+
+		while(true)
+		{
+			pos = _object.find('"', pos);
+			if(pos == std::string::npos)
+				return;
+
+			std::string key;
+			readString(key);
+
+			pos = _object.find(':', pos);
+			if(pos == std::string::npos)
+				return;
+
+			pos = _object.find_first_not_of(" \t\r\n", pos + 1);
+			if(pos == std::string::npos)
+				return;
+
+			std::string value;
+
+			if(_object[pos] == '"')
+			{
+				readString(value);
+			}
+			else
+			{
+				const auto end = _object.find_first_of(",}\r\n", pos);
+				value = _object.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+				pos = end;
+			}
+
+			_values[key] = value;
+
+			if(pos == std::string::npos)
+				return;
+		}
+	}
+
+	double percentile(const std::vector<double>& _sorted, const double _percentile)
+	{
+		if(_sorted.empty())
+			return 0.0;
+
+		const auto index = static_cast<size_t>(std::ceil(_percentile * 0.01 * static_cast<double>(_sorted.size())));
+		return _sorted[std::min(_sorted.size() - 1, index > 0 ? index - 1 : 0)];
+	}
+
+	synthLib::SMidiEvent createSysexEvent(std::vector<uint8_t>&& _sysex)
+	{
+		synthLib::SMidiEvent ev;
+		ev.sysex = std::move(_sysex);
+		return ev;
+	}
+}
+
+Benchmark::Benchmark(const virusLib::ROMFile& _rom, const Options& _options) : m_rom(_rom), m_options(_options)
+{
+}
+
+bool Benchmark::run(const std::vector<std::string>& _scenarios)
+{
+	const auto& scenarios = _scenarios.empty() ? getScenarioNames() : _scenarios;
+
+	bool success = true;
+
+	for (const auto& scenario : scenarios)
+	{
+		if(!runScenario(scenario))
+			success = false;
+	}
+
+	return success;
+}
+
+bool Benchmark::writeJson(const std::string& _filename) const
+{
+	std::ofstream f(_filename, std::ios::out | std::ios::trunc);
+
+	if(!f.is_open())
+		return false;
+
+	f << "{" << std::endl;
+	f << "\t\"rom\": \"" << synthLib::escapeJson(m_rom.getFilename()) << "\"," << std::endl;
+	f << "\t\"peakMemory\": " << getPeakMemoryUsage() << "," << std::endl;
+	f << "\t\"scenarios\": [" << std::endl;
+
+	for(size_t i=0; i<m_results.size(); ++i)
+	{
+		const auto& r = m_results[i];
+
+		f << "\t\t{";
+		f << "\"name\": \"" << synthLib::escapeJson(r.name) << "\", ";
+		f << "\"success\": " << (r.success ? "true" : "false") << ", ";
+		f << "\"error\": \"" << synthLib::escapeJson(r.error) << "\", ";
+		f << "\"samplerate\": " << r.samplerate << ", ";
+		f << "\"blockSize\": " << r.blockSize << ", ";
+		f << "\"samples\": " << r.sampleCount << ", ";
+		f << "\"bootTime\": " << r.bootSeconds << ", ";
+		f << "\"time\": " << r.seconds << ", ";
+		f << "\"realtimeFactor\": " << r.realtimeFactor << ", ";
+		f << "\"blockBudget\": " << r.blockBudget << ", ";
+		f << "\"blockMin\": " << r.blockMin << ", ";
+		f << "\"blockP50\": " << r.blockP50 << ", ";
+		f << "\"blockP90\": " << r.blockP90 << ", ";
+		f << "\"blockP99\": " << r.blockP99 << ", ";
+		f << "\"blockP999\": " << r.blockP999 << ", ";
+		f << "\"blockMax\": " << r.blockMax << ", ";
+		f << "\"blockOverruns\": " << r.blockOverruns << ", ";
+		f << "\"peakMemory\": " << r.peakMemory;
+		f << "}" << (i + 1 < m_results.size() ? "," : "") << std::endl;
+	}
+
+	f << "\t]" << std::endl;
+	f << "}" << std::endl;
+
+	return f.good();
+}
+
+bool Benchmark::readJson(std::vector<Result>& _results, const std::string& _filename)
+{
+	std::ifstream f(_filename, std::ios::in);
+
+	if(!f.is_open())
+		return false;
+
+	std::stringstream ss;
+	ss << f.rdbuf();
+	const auto json = ss.str();
+
+	auto pos = json.find("\"scenarios\"");
+	if(pos == std::string::npos)
+		return false;
+
+	while(true)
+	{
+		const auto begin = json.find('{', pos);
+		if(begin == std::string::npos)
+			break;
+
+		const auto end = json.find('}', begin);
+		if(end == std::string::npos)
+			break;
+
+		std::map<std::string, std::string> values;
+		parseFlatObject(values, json.substr(begin + 1, end - begin - 1));
+
+		pos = end + 1;
+
+		if(values.find("name") == values.end())
+			continue;
+
+		auto getDouble = [&](const char* _key)
+		{
+			const auto it = values.find(_key);
+			return it != values.end() ? std::strtod(it->second.c_str(), nullptr) : 0.0;
+		};
+
+		Result r;
+		r.name = values["name"];
+		r.success = values["success"] == "true";
+		r.error = values["error"];
+		r.samplerate = static_cast<float>(getDouble("samplerate"));
+		r.blockSize = static_cast<uint32_t>(getDouble("blockSize"));
+		r.sampleCount = static_cast<uint64_t>(getDouble("samples"));
+		r.bootSeconds = getDouble("bootTime");
+		r.seconds = getDouble("time");
+		r.realtimeFactor = getDouble("realtimeFactor");
+		r.blockBudget = getDouble("blockBudget");
+		r.blockMin = getDouble("blockMin");
+		r.blockP50 = getDouble("blockP50");
+		r.blockP90 = getDouble("blockP90");
+		r.blockP99 = getDouble("blockP99");
+		r.blockP999 = getDouble("blockP999");
+		r.blockMax = getDouble("blockMax");
+		r.blockOverruns = static_cast<uint64_t>(getDouble("blockOverruns"));
+		r.peakMemory = static_cast<uint64_t>(getDouble("peakMemory"));
+
+		_results.emplace_back(std::move(r));
+	}
+
+	return !_results.empty();
+}
+
+uint32_t Benchmark::compare(const std::vector<Result>& _baseline, const double _threshold) const
+{
+	uint32_t regressions = 0;
+
+	for (const auto& r : m_results)
+	{
+		const auto it = std::find_if(_baseline.begin(), _baseline.end(), [&](const Result& _b) { return _b.name == r.name; });
+
+		if(it == _baseline.end() || !it->success || !r.success)
+		{
+			std::cout << "SKIPPED    " << r.name << ", no valid baseline or scenario failed" << std::endl;
+			continue;
+		}
+
+		const auto& b = *it;
+
+		const auto rtfChange = b.realtimeFactor > 0.0 ? (b.realtimeFactor - r.realtimeFactor) / b.realtimeFactor : 0.0;
+		const auto p99Change = b.blockP99 > 0.0 ? (r.blockP99 - b.blockP99) / b.blockP99 : 0.0;
+
+		const bool regressed = rtfChange > _threshold || p99Change > _threshold;
+
+		if(regressed)
+			++regressions;
+
+		std::cout << (regressed ? "REGRESSION " : "OK         ") << r.name
+			<< ": realtime factor " << r.realtimeFactor << " (baseline " << b.realtimeFactor << ", " << -rtfChange * 100.0 << "%)"
+			<< ", p99 block time " << r.blockP99 << "us (baseline " << b.blockP99 << "us, " << p99Change * 100.0 << "%)" << std::endl;
+	}
+
+	return regressions;
+}
+
+const std::vector<std::string>& Benchmark::getScenarioNames()
+{
+	static const std::vector<std::string> names =
+	{
+		"chord",
+		"multi",
+		"demo",
+		"sysexStorm",
+		"ccStorm",
+		"host44100",
+		"host48000",
+		"host96000"
+	};
+	return names;
+}
+
+uint64_t Benchmark::getPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc{};
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	return pmc.PeakWorkingSetSize;
+#else
+	rusage usage{};
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+bool Benchmark::runScenario(const std::string& _name)
+{
+	const auto deviceSamplerate = static_cast<float>(m_rom.getSamplerate());
+
+	Result result;
+
+	if(_name == "chord")
+	{
+		result = runScenario(_name, deviceSamplerate, [this](synthLib::Plugin& _plugin, virusLib::Device&)
+		{
+			return setupSingle(_plugin);
+		}, playChord);
+	}
+	else if(_name == "multi")
+	{
+		result = runScenario(_name, deviceSamplerate, [this](synthLib::Plugin& _plugin, virusLib::Device&)
+		{
+			return setupMulti(_plugin);
+		},
+		[](synthLib::Plugin& _plugin)
+		{
+			// two notes on every part
+			for(uint8_t ch=0; ch<16; ++ch)
+			{
+				_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_NOTEON + ch, 48 + ch, 100));
+				_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_NOTEON + ch, 55 + ch, 100));
+			}
+		});
+	}
+	else if(_name == "demo")
+	{
+		result = runScenario(_name, deviceSamplerate, [this](synthLib::Plugin&, virusLib::Device& _device)
+		{
+			return _device.playDemo(m_rom.getDemoData());
+		}, {});
+	}
+	else if(_name == "sysexStorm")
+	{
+		result = runScenario(_name, deviceSamplerate, [this](synthLib::Plugin& _plugin, virusLib::Device&)
+		{
+			return setupSingle(_plugin);
+		}, playChord,
+		[](synthLib::Plugin& _plugin, const uint64_t _block)
+		{
+			// cutoff, cutoff 2, resonance and resonance 2 as page A parameter changes for the single part
+			constexpr uint8_t params[] = {40, 41, 42, 43};
+
+			for(uint32_t i=0; i<g_stormMessagesPerBlock; ++i)
+			{
+				const auto param = params[i & 3];
+				const auto value = static_cast<uint8_t>((_block + i) & 0x7f);
+				_plugin.addMidiEvent(createSysexEvent({synthLib::M_STARTOFSYSEX, 0x00, 0x20, 0x33, 0x01, virusLib::OMNI_DEVICE_ID, virusLib::PAGE_A, virusLib::SINGLE, param, value, synthLib::M_ENDOFSYSEX}));
+			}
+		});
+	}
+	else if(_name == "ccStorm")
+	{
+		result = runScenario(_name, deviceSamplerate, [this](synthLib::Plugin& _plugin, virusLib::Device&)
+		{
+			return setupSingle(_plugin);
+		}, playChord,
+		[](synthLib::Plugin& _plugin, const uint64_t _block)
+		{
+			// cutoff, cutoff 2, resonance, resonance 2 and the mod wheel plus pitch bend
+			constexpr uint8_t controllers[] = {40, 41, 42, 43, synthLib::MC_MODULATION};
+
+			for(uint32_t i=0; i<g_stormMessagesPerBlock; ++i)
+			{
+				const auto cc = controllers[i % std::size(controllers)];
+				const auto value = static_cast<uint8_t>((_block + i) & 0x7f);
+				_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_CONTROLCHANGE, cc, value));
+			}
+
+			_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_PITCHBEND, 0, static_cast<uint8_t>(_block & 0x7f)));
+		});
+	}
+	else
+	{
+		float samplerate = 0.0f;
+
+		for (const auto sr : g_hostSamplerates)
+		{
+			if(_name == "host" + std::to_string(static_cast<int>(sr)))
+				samplerate = sr;
+		}
+
+		if(samplerate <= 0.0f)
+		{
+			std::cout << "Unknown scenario " << _name << std::endl;
+			return false;
+		}
+
+		result = runScenario(_name, samplerate, [this](synthLib::Plugin& _plugin, virusLib::Device&)
+		{
+			return setupSingle(_plugin);
+		}, playChord);
+	}
+
+	if(result.success)
+	{
+		std::cout << result.name << ": realtime factor " << result.realtimeFactor
+			<< ", block time p50 " << result.blockP50 << "us, p99 " << result.blockP99 << "us, max " << result.blockMax << "us, budget " << result.blockBudget << "us"
+			<< ", overruns " << result.blockOverruns << std::endl;
+	}
+	else
+	{
+		std::cout << result.name << ": FAILED, " << result.error << std::endl;
+	}
+
+	m_results.push_back(result);
+
+	return result.success;
+}
+
+Benchmark::Result Benchmark::runScenario(const std::string& _name, const float _samplerate, const SetupFunc& _setup, const PlayFunc& _play, const BlockFunc& _perBlock) const
+{
+	Result result;
+	result.name = _name;
+	result.samplerate = _samplerate;
+	result.blockSize = m_options.blockSize;
+
+	std::cout << "Running scenario " << _name << " at " << _samplerate << " Hz" << std::endl;
+
+	const auto tBoot = std::chrono::steady_clock::now();
+
+	virusLib::Device device(m_rom);
+
+	if(!device.isValid())
+	{
+		result.error = "failed to create device";
+		return result;
+	}
+
+	synthLib::Plugin plugin(&device);
+
+	plugin.setSamplerate(_samplerate);
+	plugin.setBlockSize(m_options.blockSize);
+
+	result.bootSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tBoot).count();
+
+	const auto blockSize = m_options.blockSize;
+
+	std::vector<std::vector<float>> outputBuffers(device.getChannelCountOut(), std::vector<float>(blockSize));
+
+	synthLib::TAudioInputs inputs{};
+	synthLib::TAudioOutputs outputs{};
+
+	for(size_t i=0; i<outputBuffers.size() && i<outputs.size(); ++i)
+		outputs[i] = &outputBuffers[i][0];
+
+	if(!_setup(plugin, device))
+	{
+		result.error = "scenario setup failed";
+		return result;
+	}
+
+	// Preset dumps are applied asynchronously by the sysex thread of the device. Notes sent before that would be
+	// played by the wrong preset or, while the device is still in single mode, be dropped for all but the first part
+	const auto prerollBlocks = std::max<uint64_t>(1, static_cast<uint64_t>(m_options.prerollSeconds * _samplerate) / blockSize);
+
+	for(uint64_t i=0; i<prerollBlocks || device.isSysexPending(); ++i)
+		plugin.process(inputs, outputs, blockSize, 0.0f, 0.0f, false);
+
+	if(_play)
+		_play(plugin);
+
+	const auto warmupBlocks = static_cast<uint64_t>(m_options.warmupSeconds * _samplerate) / blockSize;
+	const auto blockCount = std::max<uint64_t>(1, static_cast<uint64_t>(m_options.seconds * _samplerate) / blockSize);
+
+	uint64_t block = 0;
+
+	for(uint64_t i=0; i<warmupBlocks; ++i, ++block)
+	{
+		if(_perBlock)
+			_perBlock(plugin, block);
+		plugin.process(inputs, outputs, blockSize, 0.0f, 0.0f, false);
+	}
+
+	std::vector<double> blockTimes;
+	blockTimes.reserve(blockCount);
+
+	std::vector<synthLib::SMidiEvent> midiOut;
+
+	const auto tStart = std::chrono::steady_clock::now();
+
+	for(uint64_t i=0; i<blockCount; ++i, ++block)
+	{
+		const auto t0 = std::chrono::steady_clock::now();
+
+		if(_perBlock)
+			_perBlock(plugin, block);
+
+		plugin.process(inputs, outputs, blockSize, 0.0f, 0.0f, false);
+		plugin.getMidiOut(midiOut);
+
+		const auto t1 = std::chrono::steady_clock::now();
+
+		blockTimes.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+	}
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	result.sampleCount = blockCount * blockSize;
+	result.realtimeFactor = result.seconds > 0.0 ? static_cast<double>(result.sampleCount) / static_cast<double>(_samplerate) / result.seconds : 0.0;
+	result.blockBudget = static_cast<double>(blockSize) * 1000000.0 / static_cast<double>(_samplerate);
+
+	for (const auto t : blockTimes)
+	{
+		if(t > result.blockBudget)
+			++result.blockOverruns;
+	}
+
+	std::sort(blockTimes.begin(), blockTimes.end());
+
+	result.blockMin = blockTimes.front();
+	result.blockP50 = percentile(blockTimes, 50.0);
+	result.blockP90 = percentile(blockTimes, 90.0);
+	result.blockP99 = percentile(blockTimes, 99.0);
+	result.blockP999 = percentile(blockTimes, 99.9);
+	result.blockMax = blockTimes.back();
+
+	result.peakMemory = getPeakMemoryUsage();
+	result.success = true;
+
+	return result;
+}
+
+bool Benchmark::setupSingle(synthLib::Plugin& _plugin) const
+{
+	virusLib::ROMFile::TPreset single;
+
+	if(!m_rom.getSingle(m_options.singleBank, m_options.singleProgram, single))
+		return false;
+
+	std::cout << "Using single " << virusLib::ROMFile::getSingleName(single) << std::endl;
+
+	_plugin.addMidiEvent(createSysexEvent(virusLib::Microcontroller::createPresetDump(virusLib::DUMP_SINGLE, virusLib::BankNumber::EditBuffer, virusLib::SINGLE, single)));
+	return true;
+}
+
+bool Benchmark::setupMulti(synthLib::Plugin& _plugin) const
+{
+	virusLib::ROMFile::TPreset multi;
+
+	if(!m_rom.getMulti(0, multi))
+		return false;
+
+	// one part per MIDI channel, every part uses a different single
+	for(uint8_t p=0; p<16; ++p)
+		multi[virusLib::MD_PART_MIDI_CHANNEL + p] = p;
+
+	std::cout << "Using multi " << virusLib::ROMFile::getMultiName(multi) << std::endl;
+
+	_plugin.addMidiEvent(createSysexEvent(virusLib::Microcontroller::createPresetDump(virusLib::DUMP_MULTI, virusLib::BankNumber::EditBuffer, 0, multi)));
+
+	for(uint8_t p=0; p<16; ++p)
+	{
+		virusLib::ROMFile::TPreset single;
+
+		if(!m_rom.getSingle(m_options.singleBank, (m_options.singleProgram + p) & 0x7f, single))
+			return false;
+
+		_plugin.addMidiEvent(createSysexEvent(virusLib::Microcontroller::createPresetDump(virusLib::DUMP_SINGLE, virusLib::BankNumber::EditBuffer, p, single)));
+	}
+
+	return true;
+}
+
+void Benchmark::playChord(synthLib::Plugin& _plugin)
+{
+	// eight voices, held for the whole scenario
+	constexpr uint8_t notes[] = {48, 52, 55, 59, 60, 64, 67, 71};
+
+	for (const auto note : notes)
+		_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_NOTEON, note, 100));
+}
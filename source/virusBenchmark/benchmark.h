@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace synthLib
+{
+	class Plugin;
+}
+
+namespace virusLib
+{
+	class Device;
+	class ROMFile;
+}
+
+// Runs fixed scenarios through synthLib::Plugin and measures how fast the emulation runs compared to realtime
+class Benchmark
+{
+public:
+	struct Options
+	{
+		float seconds = 10.0f;		// duration of audio rendered per scenario, excluding warm up
+		float prerollSeconds = 0.5f;	// rendered after sending the presets and before playing notes, at least until the device has applied all dumps
+		float warmupSeconds = 1.0f;	// rendered before measuring
+		uint32_t blockSize = 64;	// host block size
+		int singleBank = 0;			// preset used for all single mode scenarios
+		int singleProgram = 0;
+	};
+
+	struct Result
+	{
+		std::string name;
+		bool success = false;
+		std::string error;
+
+		float samplerate = 0.0f;	// host samplerate
+		uint32_t blockSize = 0;
+		uint64_t sampleCount = 0;
+
+		double bootSeconds = 0.0;
+		double seconds = 0.0;
+		double realtimeFactor = 0.0;	// > 1 means faster than realtime
+
+		// per block processing time in microseconds
+		double blockBudget = 0.0;
+		double blockMin = 0.0;
+		double blockP50 = 0.0;
+		double blockP90 = 0.0;
+		double blockP99 = 0.0;
+		double blockP999 = 0.0;
+		double blockMax = 0.0;
+		uint64_t blockOverruns = 0;		// blocks that took longer than the audio they produced
+
+		uint64_t peakMemory = 0;		// peak memory usage of the process in bytes at the end of the scenario
+	};
+
+	Benchmark(const virusLib::ROMFile& _rom, const Options& _options);
+
+	bool run(const std::vector<std::string>& _scenarios);
+
+	const std::vector<Result>& getResults() const { return m_results; }
+
+	bool writeJson(const std::string& _filename) const;
+	static bool readJson(std::vector<Result>& _results, const std::string& _filename);
+
+	// returns the number of scenarios whose realtime factor or 99th percentile block time is worse than the baseline by more than the given threshold
+	uint32_t compare(const std::vector<Result>& _baseline, double _threshold) const;
+
+	static const std::vector<std::string>& getScenarioNames();
+
+	static uint64_t getPeakMemoryUsage();
+
+private:
+	using SetupFunc = std::function<bool(synthLib::Plugin&, virusLib::Device&)>;
+	using PlayFunc = std::function<void(synthLib::Plugin&)>;
+	using BlockFunc = std::function<void(synthLib::Plugin&, uint64_t)>;
+
+	bool runScenario(const std::string& _name);
+	Result runScenario(const std::string& _name, float _samplerate, const SetupFunc& _setup, const PlayFunc& _play, const BlockFunc& _perBlock = {}) const;
+
+	bool setupSingle(synthLib::Plugin& _plugin) const;
+	bool setupMulti(synthLib::Plugin& _plugin) const;
+	static void playChord(synthLib::Plugin& _plugin);
+
+	const virusLib::ROMFile& m_rom;
+	const Options m_options;
+
+	std::vector<Result> m_results;
+};
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "benchmark.h"
+
+#include "../dsp56300/source/disassemble/commandline.h"
+
+#include "../synthLib/os.h"
+
+#include "../virusLib/romfile.h"
+
+namespace
+{
+	void printUsage()
+	{
+		std::cout << "Usage: virusBenchmark [-rom file.bin] [-scenarios a,b,c] [-seconds n] [-blocksize n] [-bank n] [-program n] [-json results.json] [-baseline baseline.json] [-threshold percent]" << std::endl;
+		std::cout << "Scenarios:";
+		for (const auto& name : Benchmark::getScenarioNames())
+			std::cout << ' ' << name;
+		std::cout << std::endl;
+	}
+}
+
+int main(int _argc, char* _argv[])
+{
+	try
+	{
+		const CommandLine cmd(_argc, _argv);
+
+		if(cmd.contains("help"))
+		{
+			printUsage();
+			return 0;
+		}
+
+		const auto romFile = cmd.contains("rom") ? cmd.get("rom") : synthLib::findROM(0);
+
+		if(romFile.empty())
+		{
+			std::cout << "Unable to find ROM. Specify a ROM via -rom or place a ROM file with .bin extension next to this program." << std::endl;
+			printUsage();
+			return -1;
+		}
+
+		const virusLib::ROMFile rom(romFile);
+
+		if(!rom.isValid())
+		{
+			std::cout << "ROM file " << romFile << " couldn't be loaded. Make sure that the ROM file is valid" << std::endl;
+			return -1;
+		}
+
+		Benchmark::Options options;
+
+		if(cmd.contains("seconds"))		options.seconds = std::stof(cmd.get("seconds"));
+		if(cmd.contains("blocksize"))	options.blockSize = static_cast<uint32_t>(std::max(1, cmd.getInt("blocksize")));
+		if(cmd.contains("bank"))		options.singleBank = cmd.getInt("bank");
+		if(cmd.contains("program"))		options.singleProgram = cmd.getInt("program");
+
+		std::vector<std::string> scenarios;
+
+		if(cmd.contains("scenarios"))
+		{
+			std::stringstream ss(cmd.get("scenarios"));
+			std::string name;
+			while(std::getline(ss, name, ','))
+			{
+				if(!name.empty())
+					scenarios.push_back(name);
+			}
+		}
+
+		Benchmark benchmark(rom, options);
+
+		int result = benchmark.run(scenarios) ? 0 : -1;
+
+		std::cout << "Peak memory usage " << (Benchmark::getPeakMemoryUsage() >> 10) << " KiB" << std::endl;
+
+		if(cmd.contains("json") && !benchmark.writeJson(cmd.get("json")))
+			std::cout << "Failed to write JSON results to " << cmd.get("json") << std::endl;
+
+		if(cmd.contains("baseline"))
+		{
+			std::vector<Benchmark::Result> baseline;
+
+			if(!Benchmark::readJson(baseline, cmd.get("baseline")))
+			{
+				std::cout << "Failed to read baseline from " << cmd.get("baseline") << std::endl;
+				return -1;
+			}
+
+			const auto threshold = cmd.contains("threshold") ? std::stod(cmd.get("threshold")) : 5.0;
+
+			const auto regressions = benchmark.compare(baseline, threshold * 0.01);
+
+			if(regressions)
+			{
+				std::cout << regressions << " scenarios regressed by more than " << threshold << "%" << std::endl;
+				result = -2;
+			}
+		}
+
+		return result;
+	}
+	catch(const std::runtime_error& _err)
+	{
+		std::cout << _err.what() << std::endl;
+		return -1;
+	}
+	catch(const std::logic_error& _err)
+	{
+		std::cout << "Invalid command line argument: " << _err.what() << std::endl;
+		return -1;
+	}
+}
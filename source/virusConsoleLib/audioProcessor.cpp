@@ -1,5 +1,7 @@
 #include "audioProcessor.h"
 
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "esaiListenerToFile.h"
@@ -9,17 +11,32 @@
 
 #include "../virusLib/dspSingle.h"
 
-AudioProcessor::AudioProcessor(uint32_t _samplerate, std::string _outputFilename, bool _terminateOnSilence, uint32_t _maxSamplecount, virusLib::DspSingle* _dsp1, virusLib::DspSingle* _dsp2)
+AudioProcessor::AudioProcessor(uint32_t _samplerate, std::string _outputFilename, bool _terminateOnSilence, uint32_t _maxSamplecount, virusLib::DspSingle* _dsp1, virusLib::DspSingle* _dsp2, const AudioOutputOptions& _outputOptions)
 : m_samplerate(_samplerate)
 , m_outputFilname(std::move(_outputFilename))
 , m_terminateOnSilence(_terminateOnSilence)
 , m_maxSampleCount(_maxSamplecount)
 , m_dsp1(_dsp1)
 , m_dsp2(_dsp2)
-, m_writer(m_outputFilname, _samplerate, _terminateOnSilence)
+, m_outputOptions(_outputOptions)
 {
-	m_outputBuffers.resize(2);
+	// the DSP always produces all outputs, capture all of them if requested to render stems in a single pass
+	m_outputBuffers.resize(_outputOptions.mode == AudioOutputOptions::Mode::Stereo ? 2 : 6);
 	m_inputBuffers.resize(2);
+
+	switch (_outputOptions.mode)
+	{
+	case AudioOutputOptions::Mode::Stereo:
+		m_writers.emplace_back(new synthLib::AsyncWriter(m_outputFilname, _samplerate, _terminateOnSilence, 2, _outputOptions.isFloat));
+		break;
+	case AudioOutputOptions::Mode::Stems:
+		for(uint32_t i=0; i<3; ++i)
+			m_writers.emplace_back(new synthLib::AsyncWriter(getStemFilename(m_outputFilname, i), _samplerate, _terminateOnSilence, 2, _outputOptions.isFloat));
+		break;
+	case AudioOutputOptions::Mode::MultiChannel:
+		m_writers.emplace_back(new synthLib::AsyncWriter(m_outputFilname, _samplerate, _terminateOnSilence, 6, _outputOptions.isFloat));
+		break;
+	}
 }
 
 AudioProcessor::~AudioProcessor() = default;
@@ -31,28 +48,29 @@ void AudioProcessor::processBlock(const uint32_t _blockSize)
 		for(size_t i=0; i<m_outputBuffers.size(); ++i)
 		{
 			m_outputBuffers[i].resize(_blockSize);
-			m_inputBuffers[i].resize(_blockSize);
-
-			m_inputs[i] = &m_inputBuffers[i][0];
 			m_outputs[i] = &m_outputBuffers[i][0];
 		}
 
-		m_stereoOutput.reserve(m_outputBuffers.size() * 2);
+		for(size_t i=0; i<m_inputBuffers.size(); ++i)
+		{
+			m_inputBuffers[i].resize(_blockSize);
+			m_inputs[i] = &m_inputBuffers[i][0];
+		}
 	}
 
 	const bool terminateOnSilence = m_terminateOnSilence;
 
 	auto sampleCount = static_cast<uint32_t>(m_inputBuffers[0].size());
 
-	if(terminateOnSilence && m_writer.getSilenceDuration() >= m_samplerate * 5)
+	if(terminateOnSilence && getSilenceDuration() >= m_samplerate * 5)
 	{
-		m_writer.setFinished();
+		setFinished();
 		return;
 	}
 
 	if(m_maxSampleCount && m_processedSampleCount >= m_maxSampleCount)
 	{
-		m_writer.setFinished();
+		setFinished();
 		return;
 	}
 
@@ -73,19 +91,49 @@ void AudioProcessor::processBlock(const uint32_t _blockSize)
 
 	m_processedSampleCount += sampleCount;
 
+	if(m_writers.size() == 1)
 	{
-		m_writer.append([&](std::vector<dsp56k::TWord>& _dst)
-		{
-			_dst.reserve(m_stereoOutput.size() + sampleCount * 2);
-
-			for(size_t iSrc=0; iSrc<sampleCount; ++iSrc)
-			{
-				_dst.push_back(m_outputs[0][iSrc]);
-				_dst.push_back(m_outputs[1][iSrc]);
-			}
-		});
+		m_writers.front()->append(&m_outputs[0], sampleCount);
+	}
+	else
+	{
+		for(size_t i=0; i<m_writers.size(); ++i)
+			m_writers[i]->append(&m_outputs[i<<1], sampleCount);
 	}
 
 	if(m_maxSampleCount && m_processedSampleCount >= m_maxSampleCount)
-		m_writer.setFinished();
+		setFinished();
+}
+
+std::string AudioProcessor::getStemFilename(const std::string& _filename, const uint32_t _stem)
+{
+	if(!_stem)
+		return _filename;
+
+	const auto suffix = "_" + std::to_string(_stem + 1);
+
+	const auto posDot = _filename.find_last_of('.');
+	const auto posSlash = _filename.find_last_of("/\\");
+
+	if(posDot == std::string::npos || (posSlash != std::string::npos && posDot < posSlash))
+		return _filename + suffix;
+
+	return _filename.substr(0, posDot) + suffix + _filename.substr(posDot);
+}
+
+void AudioProcessor::setFinished() const
+{
+	for (const auto& w : m_writers)
+		w->setFinished();
+}
+
+uint32_t AudioProcessor::getSilenceDuration() const
+{
+	// all outputs need to be silent
+	uint32_t duration = std::numeric_limits<uint32_t>::max();
+
+	for (const auto& w : m_writers)
+		duration = std::min(duration, w->getSilenceDuration());
+
+	return duration;
 }
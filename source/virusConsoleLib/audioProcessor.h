@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,17 +15,35 @@ namespace virusLib
 	class DspSingle;
 }
 
+struct AudioOutputOptions
+{
+	enum class Mode
+	{
+		Stereo,			// first stereo output only
+		Stems,			// one stereo file per output, the second and third get a suffix _2 and _3
+		MultiChannel	// all outputs in one six channel file
+	};
+
+	Mode mode = Mode::Stereo;
+	bool isFloat = false;
+};
+
 class AudioProcessor
 {
 public:
-	AudioProcessor(uint32_t _samplerate, std::string _outputFilename, bool _terminateOnSilence, uint32_t _maxSamplecount, virusLib::DspSingle* _dsp1, virusLib::DspSingle* _dsp2);
+	AudioProcessor(uint32_t _samplerate, std::string _outputFilename, bool _terminateOnSilence, uint32_t _maxSamplecount, virusLib::DspSingle* _dsp1, virusLib::DspSingle* _dsp2, const AudioOutputOptions& _outputOptions = {});
 	~AudioProcessor();
 
 	void processBlock(uint32_t _blockSize);
 
-	bool finished() const { return m_writer.isFinished(); }
+	bool finished() const { return m_writers.front()->isFinished(); }
+
+	static std::string getStemFilename(const std::string& _filename, uint32_t _stem);
 
 private:
+	void setFinished() const;
+	uint32_t getSilenceDuration() const;
+
 	// constant data
 	const uint32_t m_samplerate;
 	const std::string m_outputFilname;
@@ -32,6 +51,7 @@ private:
 	const uint32_t m_maxSampleCount;
 	virusLib::DspSingle* const m_dsp1;
 	virusLib::DspSingle* const m_dsp2;
+	const AudioOutputOptions m_outputOptions;
 
 	// runtime data
 	synthLib::TAudioInputsInt m_inputs{};
@@ -39,9 +59,8 @@ private:
 
 	std::vector<std::vector<dsp56k::TWord>> m_outputBuffers;
 	std::vector<std::vector<dsp56k::TWord>> m_inputBuffers;
-	std::vector<dsp56k::TWord> m_stereoOutput;
 
 	uint32_t m_processedSampleCount = 0;
 
-	synthLib::AsyncWriter m_writer;
+	std::vector<std::unique_ptr<synthLib::AsyncWriter>> m_writers;
 };
@@ -1,5 +1,7 @@
 #include "consoleApp.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 
 #include "audioProcessor.h"
@@ -21,10 +23,23 @@ ConsoleApp::ConsoleApp(const std::string& _romFile)
 : m_romName(_romFile)
 , m_rom(_romFile)
 , m_preset({})
+{
+	init();
+}
+
+ConsoleApp::ConsoleApp(const ROMFile& _rom)
+: m_romName(_rom.getFilename())
+, m_rom(_rom)
+, m_preset({})
+{
+	init();
+}
+
+void ConsoleApp::init()
 {
 	if (!m_rom.isValid())
 	{
-		std::cout << "ROM file " << _romFile << " is not valid and couldn't be loaded. Place a valid ROM file with .bin extension next to this program." << std::endl;
+		std::cout << "ROM file " << m_romName << " is not valid and couldn't be loaded. Place a valid ROM file with .bin extension next to this program." << std::endl;
 		return;
 	}
 
@@ -299,7 +314,7 @@ void ConsoleApp::audioCallback(uint32_t audioCallbackCount)
 		m_demo->process(1);
 }
 
-void ConsoleApp::run(const std::string& _audioOutputFilename, uint32_t _maxSampleCount/* = 0*/, bool _createDebugger/* = false*/)
+void ConsoleApp::run(const std::string& _audioOutputFilename, uint32_t _maxSampleCount/* = 0*/, bool _createDebugger/* = false*/, const AudioOutputOptions& _outputOptions/* = {}*/)
 {
 	assert(!_audioOutputFilename.empty());
 //	dsp.enableTrace((DSP::TraceMode)(DSP::Ops | DSP::Regs | DSP::StackIndent));
@@ -334,6 +349,8 @@ void ConsoleApp::run(const std::string& _audioOutputFilename, uint32_t _maxSampl
 		callbackCount++;
 		if((callbackCount & 0x07) == 0)
 			audioCallback(callbackCount>>3);
+
+		uc->readHdi08Tx(callbackCount>>1);
 	}, 0);
 
 	bootDSP(_createDebugger).join();
@@ -350,15 +367,36 @@ void ConsoleApp::run(const std::string& _audioOutputFilename, uint32_t _maxSampl
 
 	std::vector<synthLib::SMidiEvent> midiEvents;
 
-	AudioProcessor proc(m_rom.getSamplerate(), _audioOutputFilename, m_demo != nullptr, _maxSampleCount, m_dsp1.get(), m_dsp2);
+	// Measures how far MIDI output would be off if it was emitted at the block it has been read in instead of its timestamp
+	uint64_t midiEventCount = 0;
+	int64_t midiJitterSum = 0;
+	int32_t midiJitterMax = 0;
+
+	AudioProcessor proc(m_rom.getSamplerate(), _audioOutputFilename, m_demo != nullptr, _maxSampleCount, m_dsp1.get(), m_dsp2, _outputOptions);
 
 	while(!proc.finished())
 	{
 		sem.wait();
 		proc.processBlock(blockSize);
 		uc->processHdi08Tx(midiEvents);
+
+		const auto readFrame = callbackCount>>1;
+
+		for (const auto& ev : midiEvents)
+		{
+			const auto jitter = std::abs(static_cast<int32_t>(readFrame - ev.offset));
+			midiJitterSum += jitter;
+			midiJitterMax = std::max(midiJitterMax, jitter);
+			++midiEventCount;
+		}
+
 		midiEvents.clear();
 	}
 
 	esai.setCallback(nullptr,0);
+
+	if(midiEventCount)
+	{
+		LOG("MIDI out: " << midiEventCount << " events, block jitter avg " << static_cast<double>(midiJitterSum) / static_cast<double>(midiEventCount) << " samples, max " << midiJitterMax << " samples");
+	}
 }
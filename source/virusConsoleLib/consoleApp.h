@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 
+#include "audioProcessor.h"
 #include "esaiListener.h"
 #include "esaiListenerToCallback.h"
 #include "dsp56kEmu/memory.h"
@@ -15,6 +16,8 @@ class ConsoleApp
 {
 public:
 	ConsoleApp(const std::string& _romFile);
+	// uses an already loaded ROM, the ROM is copied
+	explicit ConsoleApp(const virusLib::ROMFile& _rom);
 	~ConsoleApp();
 
 	bool isValid() const;
@@ -30,11 +33,12 @@ public:
 
 	static void waitReturn();
 
-	void run(const std::string& _audioOutputFilename, uint32_t _maxSampleCount = 0, bool _createDebugger = false);
+	void run(const std::string& _audioOutputFilename, uint32_t _maxSampleCount = 0, bool _createDebugger = false, const AudioOutputOptions& _outputOptions = {});
 
 	const virusLib::ROMFile& getRom() const { return m_rom; }
 
 private:
+	void init();
 
 	std::thread bootDSP(bool _createDebugger) const;
 	dsp56k::IPeripherals& getYPeripherals() const;
@@ -0,0 +1,211 @@
+#include "renderEngine.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#include "../synthLib/midiFile.h"
+#include "../synthLib/sysexIterator.h"
+
+#include "../virusLib/microcontroller.h"
+
+namespace
+{
+	constexpr size_t g_sysexPresetHeaderSize = 9;
+}
+
+RenderEngine::RenderEngine(const virusLib::ROMFile& _rom, const Options& _options) : m_rom(_rom), m_options(_options), m_device(_rom), m_plugin(&m_device)
+{
+	m_plugin.setSamplerate(m_options.samplerate);
+	m_plugin.setBlockSize(m_options.blockSize);
+
+	m_outputBuffers.resize(m_device.getChannelCountOut(), std::vector<float>(m_options.blockSize));
+
+	for(size_t i=0; i<m_outputBuffers.size() && i<m_outputs.size(); ++i)
+		m_outputs[i] = &m_outputBuffers[i][0];
+
+	m_interleaved.resize(static_cast<size_t>(m_options.blockSize) << 1);
+}
+
+void RenderEngine::loadSingle(const virusLib::ROMFile::TPreset& _single)
+{
+	reset();
+
+	synthLib::SMidiEvent ev;
+	ev.sysex = virusLib::Microcontroller::createPresetDump(virusLib::DUMP_SINGLE, virusLib::BankNumber::EditBuffer, virusLib::SINGLE, _single);
+	m_plugin.addMidiEvent(ev);
+
+	// at least one block is needed to hand the dump to the device
+	processSilence(std::max<uint64_t>(m_options.blockSize, static_cast<uint64_t>(m_options.prerollSeconds * m_options.samplerate)));
+
+	// the dump is applied asynchronously by the sysex thread of the device, notes sent before that would play the previous preset
+	while(m_device.isSysexPending())
+		processSilence(m_options.blockSize);
+}
+
+bool RenderEngine::render(const uint64_t _sampleCount, const std::vector<synthLib::SMidiEvent>& _events, const Callback& _callback)
+{
+	// the output is delayed by the plugin latency, skip it to have the first event at sample position zero
+	uint64_t skip = m_plugin.getLatencyMidiToOutput();
+	const uint64_t totalSamples = _sampleCount + skip;
+
+	size_t eventIndex = 0;
+
+	for(uint64_t pos = 0; pos < totalSamples;)
+	{
+		const auto count = static_cast<uint32_t>(std::min<uint64_t>(m_options.blockSize, totalSamples - pos));
+
+		for(; eventIndex < _events.size() && _events[eventIndex].offset < pos + count; ++eventIndex)
+		{
+			// the plugin expects offsets relative to the current block
+			auto ev = _events[eventIndex];
+			ev.offset = ev.offset >= pos ? static_cast<uint32_t>(ev.offset - pos) : 0;
+			m_plugin.addMidiEvent(ev);
+		}
+
+		m_plugin.process(m_inputs, m_outputs, count, 0.0f, 0.0f, false);
+		m_plugin.getMidiOut(m_midiOut);
+
+		const auto skipCount = static_cast<uint32_t>(std::min<uint64_t>(skip, count));
+		skip -= skipCount;
+
+		size_t idx = 0;
+
+		for(uint32_t i=skipCount; i<count; ++i)
+		{
+			m_interleaved[idx++] = m_outputBuffers[0][i];
+			m_interleaved[idx++] = m_outputBuffers[1][i];
+		}
+
+		if(idx && !_callback(&m_interleaved[0], idx >> 1))
+			return false;
+
+		pos += count;
+	}
+
+	return true;
+}
+
+bool RenderEngine::findSingle(virusLib::ROMFile::TPreset& _result, const virusLib::ROMFile& _rom, const std::string& _preset)
+{
+	const bool isNumber = !_preset.empty() && std::all_of(_preset.begin(), _preset.end(), [](const char _c) { return _c >= '0' && _c <= '9'; });
+
+	if(isNumber)
+	{
+		const auto preset = std::stoi(_preset);
+		return _rom.getSingle(preset / _rom.getPresetsPerBank(), preset % _rom.getPresetsPerBank(), _result);
+	}
+
+	for (uint32_t b = 0; b < _rom.getSingleBankCount(); ++b)
+	{
+		for (int p = 0; p < _rom.getPresetsPerBank(); ++p)
+		{
+			if(!_rom.getSingle(static_cast<int>(b), p, _result))
+				return false;
+
+			const auto name = virusLib::ROMFile::getSingleName(_result);
+
+			if(name.empty())
+				return false;
+
+			if(name == _preset)
+				return true;
+		}
+	}
+	return false;
+}
+
+bool RenderEngine::getSingleFromSysex(virusLib::ROMFile::TPreset& _result, const std::vector<uint8_t>& _sysex)
+{
+	synthLib::SysexIterator it(_sysex);
+	synthLib::SysexView msg;
+
+	while(it.next(msg))
+	{
+		if(msg.size < g_sysexPresetHeaderSize + virusLib::ROMFile::getSinglePresetSize() + 2)
+			continue;
+
+		if(msg[1] != 0x00 || msg[2] != 0x20 || msg[3] != 0x33 || msg[6] != virusLib::DUMP_SINGLE)
+			continue;
+
+		_result.fill(0);
+		std::copy_n(msg.data + g_sysexPresetHeaderSize, virusLib::ROMFile::getSinglePresetSize(), _result.begin());
+		return true;
+	}
+	return false;
+}
+
+bool RenderEngine::getSingleFromSysexFile(virusLib::ROMFile::TPreset& _result, const std::string& _filename)
+{
+	std::ifstream f(_filename, std::ios::in | std::ios::binary);
+
+	if(!f.is_open())
+		return false;
+
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+	return getSingleFromSysex(_result, data);
+}
+
+bool RenderEngine::readMidiFile(std::vector<synthLib::SMidiEvent>& _events, uint64_t& _lastSample, const std::string& _filename, const float _samplerate)
+{
+	synthLib::MidiFile midi;
+
+	if(!midi.load(_filename.c_str()))
+		return false;
+
+	synthLib::MidiFile::Iterator it(midi, _samplerate);
+	synthLib::MidiFile::Event ev;
+
+	_lastSample = 0;
+
+	while(it.next(ev))
+	{
+		if(ev.sample > std::numeric_limits<uint32_t>::max())
+			return false;
+
+		_lastSample = ev.sample;
+
+		switch (ev.type)
+		{
+		case synthLib::MidiFile::EventType::Channel:
+			_events.emplace_back(ev.a, ev.b, ev.c, static_cast<uint32_t>(ev.sample));
+			break;
+		case synthLib::MidiFile::EventType::Sysex:
+			{
+				synthLib::SMidiEvent e;
+				e.sysex = std::move(ev.data);
+				e.offset = static_cast<uint32_t>(ev.sample);
+				_events.emplace_back(std::move(e));
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+void RenderEngine::reset()
+{
+	for(uint8_t ch=0; ch<16; ++ch)
+	{
+		m_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_CONTROLCHANGE + ch, synthLib::MC_ALLNOTESOFF, 0));
+		m_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_CONTROLCHANGE + ch, synthLib::MC_ALLSOUNDOFF, 0));
+		m_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_CONTROLCHANGE + ch, synthLib::MC_RESETALLCONTROLLERS, 0));
+		m_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_CONTROLCHANGE + ch, synthLib::MC_MODULATION, 0));
+		m_plugin.addMidiEvent(synthLib::SMidiEvent(synthLib::M_PITCHBEND + ch, 0x00, 0x40));
+	}
+}
+
+void RenderEngine::processSilence(uint64_t _sampleCount)
+{
+	while(_sampleCount > 0)
+	{
+		const auto count = static_cast<uint32_t>(std::min<uint64_t>(m_options.blockSize, _sampleCount));
+		m_plugin.process(m_inputs, m_outputs, count, 0.0f, 0.0f, false);
+		m_plugin.getMidiOut(m_midiOut);
+		_sampleCount -= count;
+	}
+}
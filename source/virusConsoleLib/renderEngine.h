@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../synthLib/audioTypes.h"
+#include "../synthLib/midiTypes.h"
+#include "../synthLib/plugin.h"
+
+#include "../virusLib/device.h"
+#include "../virusLib/romfile.h"
+
+// A booted device plus the plugin wrapper that renders at a host samplerate. Booting is the expensive part,
+// an engine is meant to be kept alive and reused for many renders
+class RenderEngine
+{
+public:
+	struct Options
+	{
+		float samplerate = 48000.0f;
+		uint32_t blockSize = 512;
+		float prerollSeconds = 1.0f;	// rendered and discarded after loading a preset, gives the device time to load it and lets tails of a previous render fade out
+	};
+
+	// receives stereo interleaved float data, returning false aborts rendering
+	using Callback = std::function<bool(const float* _interleaved, size_t _frameCount)>;
+
+	RenderEngine(const virusLib::ROMFile& _rom, const Options& _options);
+
+	const virusLib::ROMFile& getRom() const { return m_rom; }
+	const Options& getOptions() const { return m_options; }
+
+	// silences all voices, resets controllers, sends the single to the single edit buffer and renders the preroll,
+	// continuing until the device has applied the dump
+	void loadSingle(const virusLib::ROMFile::TPreset& _single);
+
+	// The offset of each event is the sample position relative to the start of the render, events need to be sorted.
+	// The output is compensated for the plugin latency so that the events line up with the rendered audio
+	bool render(uint64_t _sampleCount, const std::vector<synthLib::SMidiEvent>& _events, const Callback& _callback);
+
+	// finds a single by name or by number (bank * 128 + program)
+	static bool findSingle(virusLib::ROMFile::TPreset& _result, const virusLib::ROMFile& _rom, const std::string& _preset);
+
+	// uses the first single dump found in the data, regardless of the bank it was meant for
+	static bool getSingleFromSysex(virusLib::ROMFile::TPreset& _result, const std::vector<uint8_t>& _sysex);
+	static bool getSingleFromSysexFile(virusLib::ROMFile::TPreset& _result, const std::string& _filename);
+
+	// reads all channel and sysex events of a MIDI file, the offsets are sample positions at the given samplerate.
+	// Fails if an event is too far into the file for its position to fit into SMidiEvent::offset
+	static bool readMidiFile(std::vector<synthLib::SMidiEvent>& _events, uint64_t& _lastSample, const std::string& _filename, float _samplerate);
+
+private:
+	void reset();
+	void processSilence(uint64_t _sampleCount);
+
+	const virusLib::ROMFile& m_rom;
+	const Options m_options;
+
+	virusLib::Device m_device;
+	synthLib::Plugin m_plugin;
+
+	synthLib::TAudioInputs m_inputs{};
+	synthLib::TAudioOutputs m_outputs{};
+	std::vector<std::vector<float>> m_outputBuffers;
+	std::vector<float> m_interleaved;
+	std::vector<synthLib::SMidiEvent> m_midiOut;
+};
@@ -2,14 +2,21 @@
 
 #include "integrationTest.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <fstream>
+#include <thread>
 #include <utility>
 
+#include "testRunner.h"
+
 #include "../virusConsoleLib/consoleApp.h"
 
 #include "../dsp56300/source/dsp56kEmu/jitunittests.h"
 #include "../dsp56300/source/disassemble/commandline.h"
 
+#include "../synthLib/audioCompare.h"
 #include "../synthLib/wavReader.h"
 #include "../synthLib/os.h"
 
@@ -59,6 +66,8 @@ int main(int _argc, char* _argv[])
 				return -1;
 			}
 
+			TestRunner runner(cmd);
+
 			for (auto& subfolder : subfolders)
 			{
 				if(subfolder.find("/.") != std::string::npos)
@@ -142,14 +151,21 @@ int main(int _argc, char* _argv[])
 				}
 
 				for (auto& preset : presets)
-				{
-					IntegrationTest test(cmd, romFile, preset, subfolder + '/');
-					if(test.run() != 0)
-						return -1;
-				}
+					runner.add(romFile, preset, subfolder + '/');
 			}
 
-			return 0;
+			// every test runs its own DSP thread in addition to the worker thread, use half of the cores by default
+			const auto threadCount = cmd.contains("threads") ? cmd.getInt("threads") : static_cast<int>(std::thread::hardware_concurrency() >> 1);
+
+			const auto res = runner.run(static_cast<uint32_t>(std::max(1, threadCount)));
+
+			if(cmd.contains("junit") && !runner.writeJUnit(cmd.get("junit")))
+				std::cout << "Failed to write JUnit report to " << cmd.get("junit") << std::endl;
+
+			if(cmd.contains("json") && !runner.writeJson(cmd.get("json")))
+				std::cout << "Failed to write JSON report to " << cmd.get("json") << std::endl;
+
+			return res;
 		}
 
 		std::cout << "invalid command line arguments" << std::endl;
@@ -171,6 +187,15 @@ IntegrationTest::IntegrationTest(const CommandLine& _commandLine, std::string _r
 {
 }
 
+IntegrationTest::IntegrationTest(const CommandLine& _commandLine, const virusLib::ROMFile& _rom, std::string _presetName, std::string _outputFolder)
+	: m_cmd(_commandLine)
+	, m_romFile(_rom.getFilename())
+	, m_presetName(std::move(_presetName))
+	, m_outputFolder(std::move(_outputFolder))
+	, m_app(_rom)
+{
+}
+
 int IntegrationTest::run()
 {
 	if (!m_app.isValid())
@@ -202,27 +227,15 @@ int IntegrationTest::run()
 
 bool IntegrationTest::loadAudioFile(File& _dst, const std::string& _filename) const
 {
-	const auto hFile = fopen(_filename.c_str(), "rb");
-	if (!hFile)
+	if (!_dst.file.open(_filename))
 	{
 		std::cout << "Failed to load wav file " << _filename << " for comparison" << std::endl;
 		return false;
 	}
-	fseek(hFile, 0, SEEK_END);
-	const size_t size = ftell(hFile);
-	_dst.file.resize(size);
-	fseek(hFile, 0, SEEK_SET);
-	if (fread(&_dst.file.front(), 1, size, hFile) != size)
-	{
-		std::cout << "Failed to read data from file " << _filename << std::endl;
-		fclose(hFile);
-		return false;
-	}
-	fclose(hFile);
 
 	_dst.data.data = nullptr;
 
-	if (!synthLib::WavReader::load(_dst.data, nullptr, &_dst.file.front(), _dst.file.size()))
+	if (!synthLib::WavReader::load(_dst.data, nullptr, _dst.file.data(), _dst.file.size()))
 	{
 		std::cout << "Failed to interpret file " << _filename << " as wave data, make sure that the file is a valid 24 bit stereo wav file" << std::endl;
 		return false;
@@ -246,32 +259,57 @@ int IntegrationTest::runCompare()
 {
 	const auto sampleCount = m_referenceFile.data.dataByteSize * 8 / m_referenceFile.data.bitsPerSample / 2;
 
-	std::vector<uint8_t> temp;
-
 	File compareFile;
 	const auto res = createAudioFile(compareFile, "compare_", static_cast<uint32_t>(sampleCount));
 	if(res)
 		return res;
 
-	auto* ptrA = static_cast<const uint8_t*>(compareFile.data.data);
-	auto* ptrB = static_cast<const uint8_t*>(m_referenceFile.data.data);
+	synthLib::AudioCompare::Options options;
 
-	for(uint32_t i=0; i<sampleCount; ++i)
+	if(m_cmd.contains("mode") && !synthLib::AudioCompare::parseMode(options.mode, m_cmd.get("mode")))
 	{
-		const uint32_t a = (static_cast<uint32_t>(ptrA[0]) << 24) || (static_cast<uint32_t>(ptrA[1]) << 16) || ptrA[2];
-		const uint32_t b = (static_cast<uint32_t>(ptrB[0]) << 24) || (static_cast<uint32_t>(ptrB[1]) << 16) || ptrB[2];
+		std::cout << "Unknown compare mode " << m_cmd.get("mode") << ", valid modes are exact, maxabs, rms and db" << std::endl;
+		return -1;
+	}
 
-		if(b != a)
+	if(m_cmd.contains("tolerance"))
+	{
+		const auto tolerance = m_cmd.get("tolerance");
+
+		char* end = nullptr;
+		options.tolerance = std::strtod(tolerance.c_str(), &end);
+
+		if(tolerance.empty() || *end != 0 || !std::isfinite(options.tolerance))
 		{
-			std::cout << "Test failed, audio output is not identical to reference file, difference starting at frame " << (i>>1) << std::endl;
-			return -2;
+			std::cout << "Invalid compare tolerance " << tolerance << ", a number is expected" << std::endl;
+			return -1;
 		}
+	}
 
-		ptrA += 3;
-		ptrB += 3;
+	if(m_cmd.contains("diff"))
+		options.diffFilename = m_outputFolder + "diff_" + m_app.getSingleNameAsFilename();
+
+	const auto result = synthLib::AudioCompare::compare(compareFile.data, m_referenceFile.data, options);
+
+	if(!result.error.empty())
+	{
+		std::cout << "Test failed, " << result.error << std::endl;
+		return -2;
+	}
+
+	if(!result.success)
+	{
+		std::cout << "Test failed, audio output is not identical to reference file";
+		for(size_t c=0; c<result.firstDifference.size(); ++c)
+		{
+			if(result.firstDifference[c] >= 0)
+				std::cout << ", channel " << c << " differs starting at frame " << result.firstDifference[c];
+		}
+		std::cout << ". Max error " << result.maxAbsError << ", RMS error " << result.rmsError << ", relative error " << result.relativeDb << " dB" << std::endl;
+		return -2;
 	}
 
-	std::cout << "Test succeeded, compared " << sampleCount << " samples" << std::endl;
+	std::cout << "Test succeeded, compared " << result.frameCount << " frames" << std::endl;
 	return 0;
 }
 
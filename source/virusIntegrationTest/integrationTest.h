@@ -2,6 +2,7 @@
 
 #include "../virusConsoleLib/consoleApp.h"
 
+#include "../synthLib/mappedFile.h"
 #include "../synthLib/wavReader.h"
 
 class CommandLine;
@@ -10,13 +11,14 @@ class IntegrationTest
 {
 public:
 	explicit IntegrationTest(const CommandLine& _commandLine, std::string _romFile, std::string _presetName, std::string _outputFolder);
+	IntegrationTest(const CommandLine& _commandLine, const virusLib::ROMFile& _rom, std::string _presetName, std::string _outputFolder);
 
 	int run();
 
 private:
 	struct File
 	{
-		std::vector<uint8_t> file;
+		synthLib::MappedFile file;
 		synthLib::Data data;
 	};
 
@@ -0,0 +1,207 @@
+#include "testRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <exception>
+#include <thread>
+
+#include "integrationTest.h"
+
+#include "../synthLib/json.h"
+
+#include "../virusLib/romfile.h"
+
+namespace
+{
+	std::string escapeXml(const std::string& _s)
+	{
+		std::string res;
+		res.reserve(_s.size());
+
+		for (const char c : _s)
+		{
+			switch (c)
+			{
+			case '&':	res += "&amp;";		break;
+			case '<':	res += "&lt;";		break;
+			case '>':	res += "&gt;";		break;
+			case '"':	res += "&quot;";	break;
+			case '\'':	res += "&apos;";	break;
+			default:	res += c;			break;
+			}
+		}
+		return res;
+	}
+
+	std::string getResultMessage(const int _result)
+	{
+		switch (_result)
+		{
+		case 0:		return "succeeded";
+		case -2:	return "audio output is not identical to reference file";
+		default:	return "failed to run test";
+		}
+	}
+}
+
+TestRunner::TestRunner(const CommandLine& _commandLine) : m_cmd(_commandLine)
+{
+}
+
+TestRunner::~TestRunner() = default;
+
+void TestRunner::add(const std::string& _romFile, const std::string& _presetName, const std::string& _outputFolder)
+{
+	Test t;
+	t.romFile = _romFile;
+	t.presetName = _presetName;
+	t.outputFolder = _outputFolder;
+	m_tests.emplace_back(std::move(t));
+}
+
+int TestRunner::run(const uint32_t _threadCount)
+{
+	const auto tStart = std::chrono::steady_clock::now();
+
+	// load every ROM once, tests create their DSPs from the already loaded ROMs
+	for (const auto& test : m_tests)
+	{
+		auto& rom = m_roms[test.romFile];
+		if(!rom)
+			rom.reset(new virusLib::ROMFile(test.romFile));
+	}
+
+	const auto threadCount = std::min(static_cast<size_t>(_threadCount), m_tests.size());
+
+	std::cout << "Running " << m_tests.size() << " tests on " << threadCount << " threads" << std::endl;
+
+	std::atomic<size_t> nextTest = 0;
+
+	auto threadFunc = [&]()
+	{
+		while(true)
+		{
+			const auto index = nextTest++;
+			if(index >= m_tests.size())
+				break;
+			runTest(m_tests[index]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+
+	for(size_t i=0; i<threadCount; ++i)
+		threads.emplace_back(threadFunc);
+
+	for (auto& t : threads)
+		t.join();
+
+	m_totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+	uint32_t failCount = 0;
+
+	for (const auto& test : m_tests)
+	{
+		if(test.result)
+			++failCount;
+
+		std::cout << (test.result ? "FAILED  " : "OK      ") << test.outputFolder << test.presetName << " (" << test.seconds << "s)" << std::endl;
+	}
+
+	std::cout << m_tests.size() - failCount << " of " << m_tests.size() << " tests succeeded in " << m_totalSeconds << "s" << std::endl;
+
+	return failCount ? -1 : 0;
+}
+
+void TestRunner::runTest(Test& _test) const
+{
+	const auto tStart = std::chrono::steady_clock::now();
+
+	try
+	{
+		IntegrationTest test(m_cmd, *m_roms.find(_test.romFile)->second, _test.presetName, _test.outputFolder);
+		_test.result = test.run();
+	}
+	catch(const std::exception& _err)
+	{
+		// a failing test must not terminate the other worker threads
+		std::cout << _err.what() << std::endl;
+		_test.result = -1;
+	}
+
+	_test.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+}
+
+bool TestRunner::writeJUnit(const std::string& _filename) const
+{
+	std::ofstream f(_filename, std::ios::out | std::ios::trunc);
+
+	if(!f.is_open())
+		return false;
+
+	size_t failCount = 0;
+	for (const auto& test : m_tests)
+	{
+		if(test.result)
+			++failCount;
+	}
+
+	f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << std::endl;
+	f << "<testsuites tests=\"" << m_tests.size() << "\" failures=\"" << failCount << "\" time=\"" << m_totalSeconds << "\">" << std::endl;
+	f << "\t<testsuite name=\"virusIntegrationTest\" tests=\"" << m_tests.size() << "\" failures=\"" << failCount << "\" time=\"" << m_totalSeconds << "\">" << std::endl;
+
+	for (const auto& test : m_tests)
+	{
+		f << "\t\t<testcase classname=\"" << escapeXml(test.outputFolder) << "\" name=\"" << escapeXml(test.presetName) << "\" time=\"" << test.seconds << "\"";
+
+		if(!test.result)
+		{
+			f << "/>" << std::endl;
+			continue;
+		}
+
+		f << ">" << std::endl;
+		f << "\t\t\t<failure message=\"" << escapeXml(getResultMessage(test.result)) << "\"/>" << std::endl;
+		f << "\t\t</testcase>" << std::endl;
+	}
+
+	f << "\t</testsuite>" << std::endl;
+	f << "</testsuites>" << std::endl;
+
+	return f.good();
+}
+
+bool TestRunner::writeJson(const std::string& _filename) const
+{
+	std::ofstream f(_filename, std::ios::out | std::ios::trunc);
+
+	if(!f.is_open())
+		return false;
+
+	f << "{" << std::endl;
+	f << "\t\"time\": " << m_totalSeconds << "," << std::endl;
+	f << "\t\"tests\": [" << std::endl;
+
+	for(size_t i=0; i<m_tests.size(); ++i)
+	{
+		const auto& test = m_tests[i];
+
+		f << "\t\t{";
+		f << "\"rom\": \"" << synthLib::escapeJson(test.romFile) << "\", ";
+		f << "\"preset\": \"" << synthLib::escapeJson(test.presetName) << "\", ";
+		f << "\"result\": " << test.result << ", ";
+		f << "\"message\": \"" << synthLib::escapeJson(getResultMessage(test.result)) << "\", ";
+		f << "\"time\": " << test.seconds;
+		f << "}" << (i + 1 < m_tests.size() ? "," : "") << std::endl;
+	}
+
+	f << "\t]" << std::endl;
+	f << "}" << std::endl;
+
+	return f.good();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace virusLib
+{
+	class ROMFile;
+}
+
+class CommandLine;
+
+// Runs integration tests on multiple threads. Every ROM is loaded only once and shared by all tests that use it
+class TestRunner
+{
+public:
+	explicit TestRunner(const CommandLine& _commandLine);
+	~TestRunner();
+
+	void add(const std::string& _romFile, const std::string& _presetName, const std::string& _outputFolder);
+
+	int run(uint32_t _threadCount);
+
+	bool writeJUnit(const std::string& _filename) const;
+	bool writeJson(const std::string& _filename) const;
+
+private:
+	struct Test
+	{
+		std::string romFile;
+		std::string presetName;
+		std::string outputFolder;
+
+		int result = 0;
+		double seconds = 0.0;
+	};
+
+	void runTest(Test& _test) const;
+
+	const CommandLine& m_cmd;
+	std::vector<Test> m_tests;
+	std::map<std::string, std::unique_ptr<virusLib::ROMFile>> m_roms;
+	double m_totalSeconds = 0.0;
+};
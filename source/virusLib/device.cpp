@@ -44,11 +44,28 @@ namespace virusLib
 		dummyProcess(8);
 
 		m_mc->createDefaultState();
+
+		m_sysexThread = std::thread([this]
+		{
+			sysexThreadFunc();
+		});
 	}
 
 	Device::~Device()
 	{
+		if(m_sysexThread.joinable())
+		{
+			{
+				std::lock_guard lock(m_sysexMutex);
+				m_sysexThreadExit = true;
+			}
+			m_sysexCv.notify_one();
+			m_sysexThread.join();
+		}
+
 		m_dsp->getPeriphX().getEsai().setCallback(nullptr,0);
+		m_demoPlayback = nullptr;
+		m_demo.reset();
 		m_mc.reset();
 		m_dsp.reset();
 	}
@@ -65,6 +82,8 @@ namespace virusLib
 
 	void Device::process(const synthLib::TAudioInputs& _inputs, const synthLib::TAudioOutputs& _outputs, size_t _size, const std::vector<synthLib::SMidiEvent>& _midiIn, std::vector<synthLib::SMidiEvent>& _midiOut)
 	{
+		m_numSamplesInBlock = static_cast<uint32_t>(_size);
+
 		synthLib::Device::process(_inputs, _outputs, _size, _midiIn, _midiOut);
 
 		m_numSamplesProcessed += static_cast<uint32_t>(_size);
@@ -72,11 +91,13 @@ namespace virusLib
 
 	bool Device::getState(std::vector<uint8_t>& _state, const synthLib::StateType _type)
 	{
+		std::lock_guard lock(m_sysexProcessingMutex);
 		return m_mc->getState(_state, _type);
 	}
 
 	bool Device::setState(const std::vector<uint8_t>& _state, synthLib::StateType _type)
 	{
+		std::lock_guard lock(m_sysexProcessingMutex);
 		return m_mc->setState(_state, _type);
 	}
 
@@ -103,6 +124,58 @@ namespace virusLib
 		return 6;
 	}
 
+	bool Device::sendParameterChange(const synthLib::SParameterChange& _change)
+	{
+		QueuedEvent ev;
+		ev.parameterChange = _change;
+		ev.parameterChange.offset += m_numSamplesProcessed + getExtraLatencySamples();
+		ev.isParameterChange = true;
+
+		std::vector<synthLib::SMidiEvent> responses;
+		return processOrQueue(std::move(ev), responses, false);
+	}
+
+	uint32_t Device::getPresetGeneration() const
+	{
+		return m_mc ? m_mc->getPresetGeneration() : 0;
+	}
+
+	uint32_t Device::getSingleBankCount() const
+	{
+		return m_mc ? m_mc->getSingleBankCount() : 0;
+	}
+
+	uint32_t Device::getSingleBankGeneration(const uint32_t _bankIndex) const
+	{
+		return m_mc ? m_mc->getSingleBankGeneration(_bankIndex) : 0;
+	}
+
+	bool Device::getSingleBank(const uint32_t _bankIndex, std::vector<ROMFile::TPreset>& _presets, std::vector<uint32_t>& _generations, uint32_t& _bankGeneration) const
+	{
+		return m_mc && m_mc->getSingleBank(_bankIndex, _presets, _generations, _bankGeneration);
+	}
+
+	bool Device::isSysexPending() const
+	{
+		std::lock_guard lock(m_sysexMutex);
+		return m_sysexPendingCount > 0;
+	}
+
+	bool Device::playDemo(const std::vector<uint8_t>& _data)
+	{
+		if(m_demo || !m_mc || _data.size() < 8)
+			return false;
+
+		std::unique_ptr<DemoPlayback> demo(new DemoPlayback(*m_mc));
+
+		if(!demo->loadBinData(_data))
+			return false;
+
+		m_demo = std::move(demo);
+		m_demoPlayback = m_demo.get();
+		return true;
+	}
+
 	void Device::createDspInstances(DspSingle*& _dspA, DspSingle*& _dspB, const ROMFile& _rom)
 	{
 		_dspA = new DspSingle(0x040000, false);
@@ -115,28 +188,107 @@ namespace virusLib
 
 	bool Device::sendMidi(const synthLib::SMidiEvent& _ev, std::vector<synthLib::SMidiEvent>& _response)
 	{
+		QueuedEvent ev;
+		ev.midi = _ev;
+
 		if(_ev.sysex.empty())
 		{
 //			LOG("MIDI: " << std::hex << (int)_ev.a << " " << (int)_ev.b << " " << (int)_ev.c);
-			auto ev = _ev;
-			ev.offset += m_numSamplesProcessed + getExtraLatencySamples();
-			return m_mc->sendMIDI(ev);
+			ev.midi.offset += m_numSamplesProcessed + getExtraLatencySamples();
+			return processOrQueue(std::move(ev), _response, false);
 		}
 
-		std::vector<synthLib::SMidiEvent> responses;
+		// parameter changes are cheap and time critical, everything else is handed to the sysex thread
+		const auto isParameterChange = _ev.sysex.size() > 6 && (_ev.sysex[6] == PAGE_A || _ev.sysex[6] == PAGE_B || _ev.sysex[6] == PAGE_C);
 
-		if(!m_mc->sendSysex(_ev.sysex, responses, _ev.source))
-			return false;
+		return processOrQueue(std::move(ev), _response, !isParameterChange);
+	}
 
-		for (const auto& response : responses)
-			_response.emplace_back(response);
+	bool Device::processEvent(const QueuedEvent& _ev, std::vector<synthLib::SMidiEvent>& _responses) const
+	{
+		if(_ev.isParameterChange)
+			return m_mc->sendParameterChange(_ev.parameterChange);
+		if(_ev.midi.sysex.empty())
+			return m_mc->sendMIDI(_ev.midi);
+		return m_mc->sendSysex(_ev.midi.sysex, _responses, _ev.midi.source);
+	}
+
+	bool Device::processOrQueue(QueuedEvent&& _ev, std::vector<synthLib::SMidiEvent>& _responses, const bool _alwaysQueue)
+	{
+		if(!m_sysexThread.joinable())
+			return processEvent(_ev, _responses);
+
+		// Events are processed right away if the sysex thread is idle. Otherwise they are queued behind the pending
+		// dumps, both to keep their order and to not touch the microcontroller while the sysex thread is using it
+		if(!_alwaysQueue)
+		{
+			std::unique_lock processingLock(m_sysexProcessingMutex, std::try_to_lock);
+
+			if(processingLock.owns_lock())
+			{
+				bool idle;
+				{
+					std::lock_guard lock(m_sysexMutex);
+					idle = m_sysexPendingCount == 0;
+				}
+
+				if(idle)
+					return processEvent(_ev, _responses);
+			}
+		}
+
+		{
+			std::lock_guard lock(m_sysexMutex);
+			m_sysexIn.push_back(std::move(_ev));
+			++m_sysexPendingCount;
+		}
+
+		m_sysexCv.notify_one();
 
 		return true;
 	}
 
 	void Device::readMidiOut(std::vector<synthLib::SMidiEvent>& _midiOut)
 	{
-		m_mc->processHdi08Tx(_midiOut);
+		m_mc->processHdi08Tx(m_midiOutPending);
+
+		// The DSP runs ahead of the audio output by the extra latency. Convert the DSP frame of each
+		// event to an offset into the current block or keep it for one of the next blocks
+		constexpr int32_t maxDelay = 1 << 16;
+
+		const auto blockStart = m_numSamplesProcessed + getExtraLatencySamples();
+		const auto blockSize = static_cast<int32_t>(m_numSamplesInBlock);
+
+		size_t remaining = 0;
+
+		for(size_t i=0; i<m_midiOutPending.size(); ++i)
+		{
+			auto& ev = m_midiOutPending[i];
+
+			const auto delta = static_cast<int32_t>(ev.offset - blockStart);
+
+			if(delta >= blockSize && delta < maxDelay)
+			{
+				if(i != remaining)
+					m_midiOutPending[remaining] = std::move(ev);
+				++remaining;
+				continue;
+			}
+
+			ev.offset = delta > 0 && delta < blockSize ? static_cast<uint32_t>(delta) : 0;
+			_midiOut.emplace_back(std::move(ev));
+		}
+
+		m_midiOutPending.erase(m_midiOutPending.begin() + static_cast<ptrdiff_t>(remaining), m_midiOutPending.end());
+
+		// do not wait for the sysex thread, responses are picked up in one of the next blocks if it is busy
+		std::unique_lock lock(m_sysexMutex, std::try_to_lock);
+
+		if(!lock.owns_lock() || m_sysexOut.empty())
+			return;
+
+		_midiOut.insert(_midiOut.end(), std::make_move_iterator(m_sysexOut.begin()), std::make_move_iterator(m_sysexOut.end()));
+		m_sysexOut.clear();
 	}
 
 	void Device::processAudio(const synthLib::TAudioInputs& _inputs, const synthLib::TAudioOutputs& _outputs, size_t _samples)
@@ -172,11 +324,56 @@ namespace virusLib
 	{
 		m_mc->process(1);
 
+		if(auto* demo = m_demoPlayback.load(std::memory_order_acquire))
+			demo->process(1);
+
 		m_numSamplesWritten += 1;
 
+		m_mc->readHdi08Tx(m_numSamplesWritten >> 1);
+
 		m_mc->sendPendingMidiEvents(m_numSamplesWritten >> 1);
 	}
 
+	void Device::sysexThreadFunc()
+	{
+		std::vector<QueuedEvent> requests;
+		std::vector<synthLib::SMidiEvent> responses;
+
+		while(true)
+		{
+			{
+				std::unique_lock lock(m_sysexMutex);
+
+				m_sysexCv.wait(lock, [this]
+				{
+					return m_sysexThreadExit || !m_sysexIn.empty();
+				});
+
+				if(m_sysexThreadExit)
+					return;
+
+				std::swap(requests, m_sysexIn);
+			}
+
+			for (const auto& request : requests)
+			{
+				responses.clear();
+
+				{
+					std::lock_guard lock(m_sysexProcessingMutex);
+					processEvent(request, responses);
+				}
+
+				// hand out the responses of each request as soon as they are available
+				std::lock_guard lock(m_sysexMutex);
+				m_sysexOut.insert(m_sysexOut.end(), std::make_move_iterator(responses.begin()), std::make_move_iterator(responses.end()));
+				--m_sysexPendingCount;
+			}
+
+			requests.clear();
+		}
+	}
+
 	void Device::configureDSP(DspSingle& _dsp, const ROMFile& _rom)
 	{
 		auto& jit = _dsp.getJIT();
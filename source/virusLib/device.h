@@ -1,9 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "dspSingle.h"
 #include "../synthLib/midiTypes.h"
 #include "../synthLib/device.h"
 
+#include "demoplayback.h"
 #include "romfile.h"
 #include "microcontroller.h"
 
@@ -29,6 +35,20 @@ namespace virusLib
 		uint32_t getChannelCountIn() override;
 		uint32_t getChannelCountOut() override;
 
+		bool sendParameterChange(const synthLib::SParameterChange& _change) override;
+
+		// Starts playback of a demo song, for example ROMFile::getDemoData(). The demo drives the microcontroller directly and is advanced on the DSP audio thread
+		bool playDemo(const std::vector<uint8_t>& _data);
+
+		// read-only preset catalogue of the microcontroller, safe to be called from any thread
+		uint32_t getPresetGeneration() const;
+		uint32_t getSingleBankCount() const;
+		uint32_t getSingleBankGeneration(uint32_t _bankIndex) const;
+		bool getSingleBank(uint32_t _bankIndex, std::vector<ROMFile::TPreset>& _presets, std::vector<uint32_t>& _generations, uint32_t& _bankGeneration) const;
+
+		// true while sysex dumps or requests are queued or being processed on the sysex thread
+		bool isSysexPending() const;
+
 		static void createDspInstances(DspSingle*& _dspA, DspSingle*& _dspB, const ROMFile& _rom);
 		static std::thread bootDSP(DspSingle& _dsp, const ROMFile& _rom, bool _createDebugger);
 
@@ -37,6 +57,17 @@ namespace virusLib
 		void readMidiOut(std::vector<synthLib::SMidiEvent>& _midiOut) override;
 		void processAudio(const synthLib::TAudioInputs& _inputs, const synthLib::TAudioOutputs& _outputs, size_t _samples) override;
 		void onAudioWritten();
+		void sysexThreadFunc();
+
+		struct QueuedEvent
+		{
+			synthLib::SMidiEvent midi;
+			synthLib::SParameterChange parameterChange;
+			bool isParameterChange = false;
+		};
+
+		bool processEvent(const QueuedEvent& _ev, std::vector<synthLib::SMidiEvent>& _responses) const;
+		bool processOrQueue(QueuedEvent&& _ev, std::vector<synthLib::SMidiEvent>& _responses, bool _alwaysQueue);
 		static void configureDSP(DspSingle& _dsp, const ROMFile& _rom);
 
 		const ROMFile& m_rom;
@@ -44,8 +75,24 @@ namespace virusLib
 		std::unique_ptr<DspSingle> m_dsp;
 		DspSingle* m_dsp2 = nullptr;
 		std::unique_ptr<Microcontroller> m_mc;
+		std::unique_ptr<DemoPlayback> m_demo;
+		std::atomic<DemoPlayback*> m_demoPlayback = nullptr;
 
 		uint32_t m_numSamplesWritten = 0;
 		uint32_t m_numSamplesProcessed = 0;
+		uint32_t m_numSamplesInBlock = 0;
+
+		// MIDI generated by the DSP, offsets are DSP frames until it is handed out in the block it belongs to
+		std::vector<synthLib::SMidiEvent> m_midiOutPending;
+
+		// sysex requests and dumps are processed on a separate thread to not stall the audio thread
+		std::thread m_sysexThread;
+		mutable std::mutex m_sysexMutex;
+		std::mutex m_sysexProcessingMutex;
+		std::condition_variable m_sysexCv;
+		std::vector<QueuedEvent> m_sysexIn;
+		std::vector<synthLib::SMidiEvent> m_sysexOut;
+		uint32_t m_sysexPendingCount = 0;	// queued or being processed, guarded by m_sysexMutex
+		bool m_sysexThreadExit = false;
 	};
 }
@@ -5,10 +5,17 @@
 #include <thread>
 
 #include "microcontroller.h"
+#include "presetUpgradeCache.h"
 #include "romfile.h"
 
 #include "../dsp56300/source/dsp56kEmu/logging.h"
 
+#if 0
+#define LOGTX(S)	LOG(S)
+#else
+#define LOGTX(S)	{}
+#endif
+
 namespace virusLib
 {
 	const std::vector<dsp56k::TWord> g_knownPatterns[] =
@@ -16,177 +23,230 @@ namespace virusLib
 		{0xf40000, 0x7f0000}		// sent after DSP has booted
 	};
 
-	bool Hdi08TxParser::append(const dsp56k::TWord _data)
+	// unknown words are only reported this many times to not flood the log
+	constexpr uint32_t g_maxUnknownWordReports = 32;
+
+	const Hdi08TxParser::StateHandler Hdi08TxParser::g_stateHandlers[] =
 	{
-//		LOG("HDI08 TX: " << HEX(_data));
+		&Hdi08TxParser::parseDefault,
+		&Hdi08TxParser::parseSysex,
+		&Hdi08TxParser::parsePreset,
+		&Hdi08TxParser::parseStatusReport
+	};
 
-		const auto byte = static_cast<uint8_t>(_data >> 16);
+	size_t Hdi08TxParser::append(const dsp56k::TWord* _data, const uint32_t* _timestamps, const size_t _count, std::vector<synthLib::SMidiEvent>* _midiOut)
+	{
+		size_t completed = 0;
 
-		switch (m_state)
+		for(size_t i=0; i<_count; ++i)
 		{
-		case State::Default:
-			if(_data == 0xf4f4f4)
-			{
-				m_remainingPresetBytes = 0;
-				m_state = State::Default;
-				LOG("Finished receiving preset, no upgrade needed");
-			}
-			else if(_data == 0xf50000)
-			{
-				m_state = State::StatusReport;
-				m_remainingStatusBytes = m_mc.getROM().getModel() == ROMFile::Model::ABC ? 1 : 2;
-			}
-			else if(_data == 0xf400f4)
-			{
-				m_state = State::Preset;
-				LOG("Begin receiving upgraded preset");
+//			LOG("HDI08 TX: " << HEX(_data[i]));
 
-				if(m_remainingPresetBytes == 0)
-				{
-					m_remainingPresetBytes = std::numeric_limits<uint32_t>::max();
-					LOG("No one requested a preset upgrade, assuming preset size based on first word (version number)");
-				}
-			}
-			else if((_data & 0xff0000) == 0xf00000)
+			if(_timestamps)
+				m_timestamp = _timestamps[i];
+
+			const auto handler = g_stateHandlers[static_cast<size_t>(m_state)];
+
+			if((this->*handler)(_data[i], _midiOut))
+				++completed;
+		}
+
+		return completed;
+	}
+
+	bool Hdi08TxParser::parseDefault(const dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>*)
+	{
+		switch (_data)
+		{
+		case 0xf4f4f4:
+			m_remainingPresetBytes = 0;
+			m_presetUpgradeSource.clear();
+			LOG("Finished receiving preset, no upgrade needed");
+			return false;
+		case 0xf50000:
+			m_state = State::StatusReport;
+			m_remainingStatusBytes = m_mc.getROM().getModel() == ROMFile::Model::ABC ? 1 : 2;
+			return false;
+		case 0xf400f4:
+			m_state = State::Preset;
+			m_presetData.clear();
+			LOG("Begin receiving upgraded preset");
+
+			if(m_remainingPresetBytes == 0)
 			{
-				LOG("Begin reading sysex");
-				m_state = State::Sysex;
-				m_sysexData.push_back(byte);
+				m_remainingPresetBytes = std::numeric_limits<uint32_t>::max();
+				LOG("No one requested a preset upgrade, assuming preset size based on first word (version number)");
 			}
-			else
-			{
-				size_t i=0;
-				bool matched = false;
+			return false;
+		default:
+			break;
+		}
 
-				m_nonPatternWords.emplace_back(_data);
+		if((_data & 0xff0000) == 0xf00000)
+		{
+			LOGTX("Begin reading sysex");
+			m_state = State::Sysex;
+			m_sysexData.push_back(static_cast<uint8_t>(_data >> 16));
+			return false;
+		}
 
-				for (const auto& pattern : g_knownPatterns)
-				{
-					auto& pos = m_patternPositions[i];
+		matchPatterns(_data);
+		return false;
+	}
 
-					if(pattern[pos] == _data)
-					{
-						matched = true;
-
-						++pos;
-						if(pos == std::size(pattern))
-						{
-//							LOG("Matched pattern " << i);
-							const auto p = static_cast<PatternType>(i);
-
-							switch (p)
-							{
-							case PatternType::DspBoot:
-								m_dspHasBooted = true;
-								LOG("DSP boot completed");
-								break;
-							default:
-								m_matchedPatterns.push_back(p);
-								break;
-							}
-
-							pos = 0;
-							m_nonPatternWords.clear();
-						}
-					}
-					else
-					{
-						pos = 0;
-					}
+	bool Hdi08TxParser::parseSysex(const dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>* _midiOut)
+	{
+		if(_data & 0xffff)
+		{
+			LOG("Abort reading sysex, received invalid midi byte " << HEX(_data));
+			m_state = State::Default;
+			m_sysexData.clear();
+			return parseDefault(_data, _midiOut);
+		}
 
-					++i;
-				}
+		const auto byte = static_cast<uint8_t>(_data >> 16);
 
-				if(!matched)
-				{
-					std::stringstream s;
-					for (const auto& w : m_nonPatternWords)
-						s << HEX(w) << ' ';
-					LOG("Unknown DSP words: " << s.str());
-					m_nonPatternWords.clear();
-				}
-			}
-			break;
-		case State::Sysex:
-			{
-				if(_data & 0xffff)
-				{
-					LOG("Abort reading sysex, received invalid midi byte " << HEX(_data));
-					m_state = State::Default;
-					m_midiData.clear();
-					return append(_data);
-				}
+		m_sysexData.push_back(byte);
 
-				m_sysexData.push_back(byte);
+		if(byte != 0xf7)
+			return false;
 
-				if(byte == 0xf7)
-				{
-					LOG("End reading sysex");
+		LOGTX("Received sysex of size " << m_sysexData.size());
+
+		m_state = State::Default;
 
-					m_state = State::Default;
+		if(_midiOut)
+		{
+			auto& ev = _midiOut->emplace_back();
+			ev.sysex.assign(m_sysexData.begin(), m_sysexData.end());
+			ev.offset = m_timestamp;
+		}
 
-					std::stringstream s;
-					for (const auto b : m_sysexData)
-						s << HEXN(b, 2);
+		// keep the capacity for the next message
+		m_sysexData.clear();
 
-					LOG("Received sysex: " << s.str());
+		return true;
+	}
 
-					synthLib::SMidiEvent ev;
-					std::swap(ev.sysex, m_sysexData);
-					m_midiData.emplace_back(ev);
+	bool Hdi08TxParser::parsePreset(const dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>*)
+	{
+		if(m_remainingPresetBytes == std::numeric_limits<uint32_t>::max())
+		{
+			const auto version = static_cast<uint8_t>(_data >> 16);
 
-					return true;
-				}
+			switch (version)
+			{
+			case 1:
+			case 2:
+				m_remainingPresetBytes = m_mc.getROM().getMultiPresetSize();
+				break;
+			default:
+				m_remainingPresetBytes = m_mc.getROM().getSinglePresetSize();
+				break;
 			}
-			break;
-		case State::Preset:
+			LOG("Preset size for version code " << static_cast<int>(version) << " is " << m_remainingPresetBytes);
+		}
+
+		uint32_t shift = 16;
+		uint32_t i=0;
+		while(m_remainingPresetBytes > 0 && i < 3)
+		{
+			m_presetData.push_back((_data >> shift) & 0xff);
+			shift -= 8;
+			--m_remainingPresetBytes;
+			++i;
+		}
+
+		if(m_remainingPresetBytes == 0)
+		{
+			LOG("Succesfully received preset");
+			m_state = State::Default;
+
+			PresetUpgradeCache::instance().add(m_mc.getROM().getHash(), m_presetUpgradeSource, m_presetData);
+
+			m_presetUpgradeSource.clear();
+			m_presetData.clear();
+		}
+		return false;
+	}
+
+	bool Hdi08TxParser::parseStatusReport(const dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>*)
+	{
+		m_dspStatus.push_back(_data);
+		if(--m_remainingStatusBytes == 0)
+			m_state = State::Default;
+		return false;
+	}
+
+	void Hdi08TxParser::matchPatterns(const dsp56k::TWord _data)
+	{
+		size_t i=0;
+		bool matched = false;
+
+		m_nonPatternWords.emplace_back(_data);
+
+		for (const auto& pattern : g_knownPatterns)
+		{
+			auto& pos = m_patternPositions[i];
+
+			if(pattern[pos] == _data)
 			{
-				if(m_remainingPresetBytes == std::numeric_limits<uint32_t>::max())
+				matched = true;
+
+				++pos;
+				if(pos == std::size(pattern))
 				{
-					const auto version = byte;
+//					LOG("Matched pattern " << i);
+					const auto p = static_cast<PatternType>(i);
 
-					switch (version)
+					switch (p)
 					{
-					case 1:
-					case 2:
-						m_remainingPresetBytes = m_mc.getROM().getMultiPresetSize();
+					case PatternType::DspBoot:
+						m_dspHasBooted = true;
+						LOG("DSP boot completed");
 						break;
 					default:
-						m_remainingPresetBytes = m_mc.getROM().getSinglePresetSize();
+						m_matchedPatterns.push_back(p);
 						break;
 					}
-					LOG("Preset size for version code " << static_cast<int>(version) << " is " << m_remainingPresetBytes);
-				}
 
-				uint32_t shift = 16;
-				uint32_t i=0;
-				while(m_remainingPresetBytes > 0 && i < 3)
-				{
-					m_presetData.push_back((_data >> shift) & 0xff);
-					shift -= 8;
-					--m_remainingPresetBytes;
-					++i;
-				}
-
-				if(m_remainingPresetBytes == 0)
-				{
-					LOG("Succesfully received preset");
-					m_state = State::Default;
+					pos = 0;
+					m_nonPatternWords.clear();
 				}
 			}
-			break;
-		case State::StatusReport:
-			m_dspStatus.push_back(_data);
-			if(--m_remainingStatusBytes == 0)
-				m_state = State::Default;
-			break;
+			else
+			{
+				pos = 0;
+			}
+
+			++i;
 		}
 
-		return false;
+		if(!matched)
+			logUnknownWords();
+	}
+
+	void Hdi08TxParser::logUnknownWords()
+	{
+		if(m_unknownWordReports < g_maxUnknownWordReports)
+		{
+			++m_unknownWordReports;
+
+			std::stringstream s;
+			for (const auto& w : m_nonPatternWords)
+				s << HEX(w) << ' ';
+			LOG("Unknown DSP words: " << s.str());
+
+			if(m_unknownWordReports == g_maxUnknownWordReports)
+				LOG("Too many unknown DSP words, further ones are not reported");
+		}
+
+		m_nonPatternWords.clear();
 	}
 
-	void Hdi08TxParser::waitForPreset(uint32_t _byteCount)
+	void Hdi08TxParser::waitForPreset(uint32_t _byteCount, const std::vector<dsp56k::TWord>& _sourcePreset/* = {}*/)
 	{
 		m_remainingPresetBytes = _byteCount;
+		m_presetUpgradeSource = _sourcePreset;
 	}
 }
@@ -17,7 +17,9 @@ namespace virusLib
 			Default,
 			Sysex,
 			Preset,
-			StatusReport
+			StatusReport,
+
+			Count
 		};
 
 		enum class PatternType
@@ -32,10 +34,11 @@ namespace virusLib
 			m_patternPositions.fill(0);
 		}
 
-		bool append(dsp56k::TWord _data);
-		const std::vector<synthLib::SMidiEvent>& getMidiData() const { return m_midiData; }
-		void clearMidiData() { m_midiData.clear(); }
-		void waitForPreset(uint32_t _byteCount);
+		// Parses a batch of words read from the DSP. Completed sysex messages are appended to _midiOut, if it is not null.
+		// If timestamps are given, the offset of a message is set to the timestamp of its last word.
+		// Returns the number of completed sysex messages
+		size_t append(const dsp56k::TWord* _data, const uint32_t* _timestamps, size_t _count, std::vector<synthLib::SMidiEvent>* _midiOut);
+		void waitForPreset(uint32_t _byteCount, const std::vector<dsp56k::TWord>& _sourcePreset = {});
 
 		bool waitingForPreset() const
 		{
@@ -48,11 +51,23 @@ namespace virusLib
 		}
 
 	private:
+		using StateHandler = bool (Hdi08TxParser::*)(dsp56k::TWord, std::vector<synthLib::SMidiEvent>*);
+
+		bool parseDefault(dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>* _midiOut);
+		bool parseSysex(dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>* _midiOut);
+		bool parsePreset(dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>* _midiOut);
+		bool parseStatusReport(dsp56k::TWord _data, std::vector<synthLib::SMidiEvent>* _midiOut);
+
+		void matchPatterns(dsp56k::TWord _data);
+		void logUnknownWords();
+
+		static const StateHandler g_stateHandlers[static_cast<size_t>(State::Count)];
+
 		Microcontroller& m_mc;
 
-		std::vector<synthLib::SMidiEvent> m_midiData;
 		std::vector<uint8_t> m_sysexData;
 		std::vector<uint8_t> m_presetData;
+		std::vector<dsp56k::TWord> m_presetUpgradeSource;
 		std::vector<dsp56k::TWord> m_dspStatus;
 
 		uint32_t m_remainingPresetBytes = 0;
@@ -65,6 +80,9 @@ namespace virusLib
 
 		std::array<size_t, static_cast<size_t>(PatternType::Count)> m_patternPositions = {};
 
+		uint32_t m_unknownWordReports = 0;
+		uint32_t m_timestamp = 0;
+
 		bool m_dspHasBooted = false;
 	};
 }
@@ -4,6 +4,7 @@
 #include <cstring> // memcpy
 
 #include "microcontroller.h"
+#include "presetUpgradeCache.h"
 
 #include "../synthLib/midiTypes.h"
 
@@ -48,6 +49,8 @@ Microcontroller::Microcontroller(HDI08& _hdi08, const ROMFile& _romFile) : m_rom
 
 	m_hdi08TxParsers.reserve(2);
 	m_hdi08TxParsers.emplace_back(*this);
+	m_hdi08TxBuffers.resize(1);
+	m_hdi08TxParseBuffers.resize(1);
 
 	m_globalSettings.fill(0xffffffff);
 
@@ -80,7 +83,11 @@ Microcontroller::Microcontroller(HDI08& _hdi08, const ROMFile& _romFile) : m_rom
 		}
 
 		if(!singles.empty())
+		{
+			m_singleGenerations.emplace_back(singles.size(), m_presetGeneration);
+			m_singleBankGenerations.push_back(m_presetGeneration);
 			m_singles.emplace_back(std::move(singles));
+		}
 	}
 
 	if(!m_singles.empty())
@@ -163,18 +170,22 @@ bool Microcontroller::sendPreset(const uint8_t program, const std::vector<TWord>
 		return true;
 	}
 
+	// If the DSP did upgrade this preset before, send the upgraded version so that it doesn't need to do it again
+	std::vector<TWord> upgradedPreset;
+	const bool isUpgraded = PresetUpgradeCache::instance().find(m_rom.getHash(), preset, upgradedPreset);
+
 	writeHostBitsWithWait(0,1);
 	// Send header
 	TWord buf[] = {0xf47555, static_cast<TWord>(isMulti ? 0x110000 : 0x100000)};
 	buf[1] = buf[1] | (program << 8);
 	m_hdi08.writeRX(buf, 2);
 
-	m_hdi08.writeRX(preset);
+	m_hdi08.writeRX(isUpgraded ? upgradedPreset : preset);
 
-	LOG("Send to DSP: " << (isMulti ? "Multi" : "Single") << " to program " << static_cast<int>(program));
+	LOG("Send to DSP: " << (isMulti ? "Multi" : "Single") << " to program " << static_cast<int>(program) << (isUpgraded ? ", using cached upgrade" : ""));
 
 	for (auto& parser : m_hdi08TxParsers)
-		parser.waitForPreset(isMulti ? m_rom.getMultiPresetSize() : m_rom.getSinglePresetSize());
+		parser.waitForPreset(isMulti ? m_rom.getMultiPresetSize() : m_rom.getSinglePresetSize(), isUpgraded ? std::vector<TWord>() : preset);
 
 	return true;
 }
@@ -247,6 +258,88 @@ bool Microcontroller::sendMIDI(const SMidiEvent& _ev)
 	return true;
 }
 
+bool Microcontroller::sendParameter(const Page _page, const uint8_t _part, const uint8_t _param, const uint8_t _value)
+{
+	if(_page == globalSettingsPage() && _param == PLAY_MODE)
+	{
+		const auto playMode = _value;
+
+		send(_page, _part, _param, _value);
+
+		switch(playMode)
+		{
+		case PlayModeSingle:
+			{
+				LOG("Switch to Single mode");
+				return writeSingle(BankNumber::EditBuffer, SINGLE, m_singleEditBuffer);
+			}
+		case PlayModeMultiSingle:
+		case PlayModeMulti:
+			{
+				writeMulti(BankNumber::EditBuffer, 0, m_multiEditBuffer);
+				for(uint8_t i=0; i<16; ++i)
+					writeSingle(BankNumber::EditBuffer, i, m_singleEditBuffers[i]);
+				return true;
+			}
+		default:
+			return true;
+		}
+	}
+
+	applyToEditBuffers(_page, _part, _param, _value);
+
+	if(_page == PAGE_C)
+	{
+		const auto command = static_cast<ControlCommand>(_param);
+
+		switch(command)
+		{
+		case PART_BANK_SELECT:
+			return partBankSelect(_part, _value, false);
+		case PART_BANK_CHANGE:
+			return partBankSelect(_part, _value, true);
+		case PART_PROGRAM_CHANGE:
+			return partProgramChange(_part, _value);
+		case MULTI_PROGRAM_CHANGE:
+			if(_part == 0)
+			{
+				return multiProgramChange(_value);
+			}
+			return true;
+		default:
+			break;
+		}
+	}
+
+	return send(_page, _part, _param, _value);
+}
+
+bool Microcontroller::sendParameterChange(const synthLib::SParameterChange& _change)
+{
+	const auto page = static_cast<Page>(_change.page);
+
+	if(!isPageSupported(page))
+		return false;
+
+	// preset and play mode changes cannot be delayed as they involve sending presets to the DSP
+	if(isPresetCommand(page, _change.index))
+		return sendParameter(page, _change.part, _change.index, _change.value);
+
+	std::lock_guard lock(m_mutex);
+
+	applyToEditBuffers(page, _change.part, _change.index, _change.value);
+
+	// if the DSP does not keep up, send the oldest change now instead of overrunning the ring buffer, same as Plugin::addParameterChange
+	if(m_pendingParameterChanges.full())
+	{
+		const auto oldest = m_pendingParameterChanges.pop_front();
+		send(static_cast<Page>(oldest.page), oldest.part, oldest.index, oldest.value);
+	}
+
+	m_pendingParameterChanges.push_back(_change);
+	return true;
+}
+
 bool Microcontroller::sendSysex(const std::vector<uint8_t>& _data, std::vector<SMidiEvent>& _responses, const MidiEventSource _source)
 {
 	if (_data.size() < 7)
@@ -518,74 +611,12 @@ bool Microcontroller::sendSysex(const std::vector<uint8_t>& _data, std::vector<S
 				if(!isPageSupported(page))
 					break;
 
-				auto part = _data[7];
+				const auto part = _data[7];
 				const auto param = _data[8];
 				const auto value = _data[9];
 
-				if(page == globalSettingsPage() && param == PLAY_MODE)
-				{
-					const auto playMode = value;
-
-					send(page, part, param, value);
-
-					switch(playMode)
-					{
-					case PlayModeSingle:
-						{
-							LOG("Switch to Single mode");
-							return writeSingle(BankNumber::EditBuffer, SINGLE, m_singleEditBuffer);
-						}
-					case PlayModeMultiSingle:
-					case PlayModeMulti:
-						{
-							writeMulti(BankNumber::EditBuffer, 0, m_multiEditBuffer);
-							for(uint8_t i=0; i<16; ++i)
-								writeSingle(BankNumber::EditBuffer, i, m_singleEditBuffers[i]);
-							return true;
-						}
-					default:
-						return true;
-					}
-				}
-
-				if(page == PAGE_C || (page == PAGE_B && param == CLOCK_TEMPO))
-				{
-					applyToMultiEditBuffer(part, param, value);
-
-					const auto command = static_cast<ControlCommand>(param);
-
-					switch(command)
-					{
-					case PART_BANK_SELECT:
-						return partBankSelect(part, value, false);
-					case PART_BANK_CHANGE:
-						return partBankSelect(part, value, true);
-					case PART_PROGRAM_CHANGE:
-						return partProgramChange(part, value);
-					case MULTI_PROGRAM_CHANGE:
-						if(part == 0)
-						{
-							return multiProgramChange(value);
-						}
-						return true;
-					}
-				}
-				else
-				{
-					if (m_globalSettings[PLAY_MODE] != PlayModeSingle || part == SINGLE)
-					{
-						// virus only applies sysex changes to other parts while in multi mode.
-						applyToSingleEditBuffer(page, part, param, value);
-					}
-					if (m_globalSettings[PLAY_MODE] == PlayModeSingle && part == 0)
-					{
-						// accept parameter changes in single mode even if sent for part 0, this is how the editor does it right now
-						applyToSingleEditBuffer(page, SINGLE, param, value);
-					}
-				}
-
 				// bounce back to UI if not sent by editor
-				if(_source != MidiEventSourceEditor)
+				if(_source != MidiEventSourceEditor && !isPresetCommand(page, param))
 				{
 					SMidiEvent ev;
 					ev.sysex = _data;
@@ -593,7 +624,7 @@ bool Microcontroller::sendSysex(const std::vector<uint8_t>& _data, std::vector<S
 					_responses.push_back(ev);
 				}
 
-				return send(page, part, param, value);
+				return sendParameter(page, part, param, value);
 			}
 		default:
 			LOG("Unknown sysex command " << HEXN(cmd, 2));
@@ -655,6 +686,31 @@ bool Microcontroller::getSingle(BankNumber _bank, uint32_t _preset, TPreset& _re
 	return true;
 }
 
+uint32_t Microcontroller::getSingleBankCount() const
+{
+	return static_cast<uint32_t>(m_singles.size());
+}
+
+uint32_t Microcontroller::getSingleBankGeneration(const uint32_t _bankIndex) const
+{
+	std::lock_guard lock(m_catalogueMutex);
+
+	return _bankIndex < m_singleBankGenerations.size() ? m_singleBankGenerations[_bankIndex] : 0;
+}
+
+bool Microcontroller::getSingleBank(const uint32_t _bankIndex, std::vector<TPreset>& _presets, std::vector<uint32_t>& _generations, uint32_t& _bankGeneration) const
+{
+	std::lock_guard lock(m_catalogueMutex);
+
+	if(_bankIndex >= m_singles.size())
+		return false;
+
+	_presets = m_singles[_bankIndex];
+	_generations = m_singleGenerations[_bankIndex];
+	_bankGeneration = m_singleBankGenerations[_bankIndex];
+	return true;
+}
+
 bool Microcontroller::requestMulti(BankNumber _bank, uint8_t _program, TPreset& _data) const
 {
 	if (_bank == BankNumber::EditBuffer)
@@ -701,7 +757,14 @@ bool Microcontroller::writeSingle(BankNumber _bank, uint8_t _program, const TPre
 		if(_program >= m_singles[bank].size())
 			return true;	// out of range
 
+		std::lock_guard lock(m_mutex);
+		std::lock_guard lockCatalogue(m_catalogueMutex);
+
+		const auto generation = ++m_presetGeneration;
+
 		m_singles[bank][_program] = _data;
+		m_singleGenerations[bank][_program] = generation;
+		m_singleBankGenerations[bank] = generation;
 
 		return true;
 	}
@@ -936,6 +999,18 @@ bool Microcontroller::sendMIDItoDSP(uint8_t _a, const uint8_t _b, const uint8_t
 
 void Microcontroller::sendPendingMidiEvents(const uint32_t _maxOffset)
 {
+	{
+		// sendParameterChange pushes from another thread and drains the buffer if it is full
+		std::lock_guard lock(m_mutex);
+
+		while(!m_pendingParameterChanges.empty() && m_pendingParameterChanges.front().offset <= _maxOffset)
+		{
+			const auto& change = m_pendingParameterChanges.front();
+			send(static_cast<Page>(change.page), change.part, change.index, change.value);
+			m_pendingParameterChanges.pop_front();
+		}
+	}
+
 	auto size = m_pendingMidiEvents.size();
 
 	if(!size)
@@ -957,26 +1032,70 @@ void Microcontroller::addHDI08(dsp56k::HDI08& _hdi08)
 {
 	m_hdi08.addHDI08(_hdi08);
 	m_hdi08TxParsers.emplace_back(*this);
+
+	std::lock_guard lock(m_hdi08TxMutex);
+	m_hdi08TxBuffers.resize(m_hdi08TxParsers.size());
+	m_hdi08TxParseBuffers.resize(m_hdi08TxParsers.size());
+}
+
+void Microcontroller::readHdi08Tx(const uint32_t _timestamp)
+{
+	bool hasTX = false;
+
+	for(size_t i=0; i<m_hdi08.size() && !hasTX; ++i)
+		hasTX = m_hdi08.get(i)->hasTX();
+
+	if(!hasTX)
+	{
+		m_hdi08TxTimestamp = _timestamp;
+		return;
+	}
+
+	std::lock_guard lock(m_hdi08TxMutex);
+	readHdi08TxWords(_timestamp);
 }
 
 void Microcontroller::processHdi08Tx(std::vector<synthLib::SMidiEvent>& _midiEvents)
 {
 	std::lock_guard lock(m_mutex);
 
+	{
+		std::lock_guard lockTx(m_hdi08TxMutex);
+
+		// pick up words that have been written since the last call of readHdi08Tx, if any
+		readHdi08TxWords(m_hdi08TxTimestamp);
+
+		std::swap(m_hdi08TxBuffers, m_hdi08TxParseBuffers);
+	}
+
+	for(size_t i=0; i<m_hdi08TxParseBuffers.size(); ++i)
+	{
+		auto& buf = m_hdi08TxParseBuffers[i];
+
+		if(buf.words.empty())
+			continue;
+
+		// only the first DSP sends MIDI
+		m_hdi08TxParsers[i].append(buf.words.data(), buf.timestamps.data(), buf.words.size(), i == 0 ? &_midiEvents : nullptr);
+
+		buf.words.clear();
+		buf.timestamps.clear();
+	}
+}
+
+void Microcontroller::readHdi08TxWords(const uint32_t _timestamp)
+{
+	m_hdi08TxTimestamp = _timestamp;
+
 	for(size_t i=0; i<m_hdi08.size(); ++i)
 	{
 		auto* hdi08 = m_hdi08.get(i);
-		auto& parser = m_hdi08TxParsers[i];
+		auto& buf = m_hdi08TxBuffers[i];
 
 		while(hdi08->hasTX())
 		{
-			if(parser.append(hdi08->readTX()))
-			{
-				const auto midi = parser.getMidiData();
-				if(i == 0)
-					_midiEvents.insert(_midiEvents.end(), midi.begin(), midi.end());
-				parser.clearMidiData();
-			}
+			buf.words.push_back(hdi08->readTX());
+			buf.timestamps.push_back(_timestamp);
 		}
 	}
 }
@@ -1005,6 +1124,15 @@ uint8_t Microcontroller::calcChecksum(const std::vector<uint8_t>& _data, const s
 	return cs & 0x7f;
 }
 
+std::vector<uint8_t> Microcontroller::createPresetDump(const SysexMessageType _type, const BankNumber _bank, const uint8_t _program, const TPreset& _preset)
+{
+	std::vector<uint8_t> sysex = {M_STARTOFSYSEX, 0x00, 0x20, 0x33, 0x01, OMNI_DEVICE_ID, _type, toMidiByte(_bank), _program};
+	sysex.insert(sysex.end(), _preset.begin(), _preset.begin() + ROMFile::getSinglePresetSize());
+	sysex.push_back(calcChecksum(sysex, 5));
+	sysex.push_back(M_ENDOFSYSEX);
+	return sysex;
+}
+
 bool Microcontroller::dspHasBooted() const
 {
 	for (const auto &p : m_hdi08TxParsers)
@@ -1044,6 +1172,26 @@ void Microcontroller::applyToSingleEditBuffer(TPreset& _single, const Page _page
 	_single[offset] = _value;
 }
 
+void Microcontroller::applyToEditBuffers(const Page _page, const uint8_t _part, const uint8_t _param, const uint8_t _value)
+{
+	if(_page == PAGE_C || (_page == PAGE_B && _param == CLOCK_TEMPO))
+	{
+		applyToMultiEditBuffer(_part, _param, _value);
+		return;
+	}
+
+	if (m_globalSettings[PLAY_MODE] != PlayModeSingle || _part == SINGLE)
+	{
+		// virus only applies sysex changes to other parts while in multi mode.
+		applyToSingleEditBuffer(_page, _part, _param, _value);
+	}
+	if (m_globalSettings[PLAY_MODE] == PlayModeSingle && _part == 0)
+	{
+		// accept parameter changes in single mode even if sent for part 0, this is how the editor does it right now
+		applyToSingleEditBuffer(_page, SINGLE, _param, _value);
+	}
+}
+
 void Microcontroller::applyToMultiEditBuffer(const uint8_t _part, const uint8_t _param, const uint8_t _value)
 {
 	// remap page C parameters into the multi edit buffer
@@ -1060,6 +1208,26 @@ Page Microcontroller::globalSettingsPage() const
 	return PAGE_C;
 }
 
+bool Microcontroller::isPresetCommand(const Page _page, const uint8_t _param) const
+{
+	if(_page == globalSettingsPage() && _param == PLAY_MODE)
+		return true;
+
+	if(_page != PAGE_C)
+		return false;
+
+	switch(_param)
+	{
+	case PART_BANK_SELECT:
+	case PART_BANK_CHANGE:
+	case PART_PROGRAM_CHANGE:
+	case MULTI_PROGRAM_CHANGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 bool Microcontroller::isPageSupported(Page _page) const
 {
 	switch (_page)
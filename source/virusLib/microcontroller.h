@@ -9,6 +9,7 @@
 #include "../synthLib/deviceTypes.h"
 #include "../synthLib/midiTypes.h"
 
+#include <atomic>
 #include <list>
 #include <mutex>
 
@@ -29,6 +30,8 @@ public:
 
 	bool sendMIDI(const synthLib::SMidiEvent& _ev);
 	bool sendSysex(const std::vector<uint8_t>& _data, std::vector<synthLib::SMidiEvent>& _responses, synthLib::MidiEventSource _source);
+	bool sendParameter(Page _page, uint8_t _part, uint8_t _param, uint8_t _value);
+	bool sendParameterChange(const synthLib::SParameterChange& _change);
 
 	bool writeSingle(BankNumber _bank, uint8_t _program, const TPreset& _data);
 	bool writeMulti(BankNumber _bank, uint8_t _program, const TPreset& _data);
@@ -49,6 +52,9 @@ public:
 
 	void addHDI08(dsp56k::HDI08& _hdi08);
 
+	// Reads all words that the DSPs have written and tags them with the given timestamp. Intended to be called from the ESAI callback
+	void readHdi08Tx(uint32_t _timestamp);
+	// Parses the words read so far. The offset of the resulting events is the timestamp that was passed to readHdi08Tx
 	void processHdi08Tx(std::vector<synthLib::SMidiEvent>& _midiEvents);
 
 	static PresetVersion getPresetVersion(const TPreset& _preset);
@@ -56,8 +62,19 @@ public:
 
 	static uint8_t calcChecksum(const std::vector<uint8_t>& _data, const size_t _offset);
 
+	// creates a single or multi dump sysex message for model A/B/C presets, addressed to all devices
+	static std::vector<uint8_t> createPresetDump(SysexMessageType _type, BankNumber _bank, uint8_t _program, const TPreset& _preset);
+
 	bool dspHasBooted() const;
 
+	// Read-only preset catalogue, safe to be called from any thread. Every write to a single bank entry assigns a new
+	// generation to it, its bank and the catalogue, clients only need to fetch banks and entries whose generation changed.
+	// The catalogue has its own lock to not compete with the DSP for m_mutex
+	uint32_t getPresetGeneration() const { return m_presetGeneration; }
+	uint32_t getSingleBankCount() const;
+	uint32_t getSingleBankGeneration(uint32_t _bankIndex) const;
+	bool getSingleBank(uint32_t _bankIndex, std::vector<TPreset>& _presets, std::vector<uint32_t>& _generations, uint32_t& _bankGeneration) const;
+
 	const ROMFile& getROM() const { return m_rom; }
 
 private:
@@ -78,13 +95,28 @@ private:
 	void applyToSingleEditBuffer(Page _page, uint8_t _part, uint8_t _param, uint8_t _value);
 	void applyToSingleEditBuffer(TPreset& _single, Page _page, uint8_t _param, uint8_t _value) const;
 	void applyToMultiEditBuffer(uint8_t _part, uint8_t _param, uint8_t _value);
+	void applyToEditBuffers(Page _page, uint8_t _part, uint8_t _param, uint8_t _value);
 	Page globalSettingsPage() const;
 	bool isPageSupported(Page _page) const;
+	bool isPresetCommand(Page _page, uint8_t _param) const;
 	bool waitingForPresetReceiveConfirmation() const;
 
 	dsp56k::HDI08Queue m_hdi08;
 	std::vector<Hdi08TxParser> m_hdi08TxParsers;
 
+	struct Hdi08TxBuffer
+	{
+		std::vector<dsp56k::TWord> words;
+		std::vector<uint32_t> timestamps;
+	};
+
+	void readHdi08TxWords(uint32_t _timestamp);
+
+	std::vector<Hdi08TxBuffer> m_hdi08TxBuffers;
+	std::vector<Hdi08TxBuffer> m_hdi08TxParseBuffers;
+	std::mutex m_hdi08TxMutex;
+	std::atomic<uint32_t> m_hdi08TxTimestamp = 0;
+
 	const ROMFile& m_rom;
 
 	std::array<TPreset,128> m_multis;
@@ -92,6 +124,10 @@ private:
 
 	std::array<uint32_t, 256> m_globalSettings;
 	std::vector<std::vector<TPreset>> m_singles;
+	std::vector<std::vector<uint32_t>> m_singleGenerations;
+	std::vector<uint32_t> m_singleBankGenerations;
+	std::atomic<uint32_t> m_presetGeneration = 1;
+	mutable std::mutex m_catalogueMutex;	// guards writes to m_singles and the generations against catalogue readers
 
 	// Multi mode
 	std::array<TPreset,16> m_singleEditBuffers;
@@ -112,6 +148,7 @@ private:
 	std::list<SPendingPresetWrite> m_pendingPresetWrites;
 
 	dsp56k::RingBuffer<synthLib::SMidiEvent, 1024, false> m_pendingMidiEvents;
+	dsp56k::RingBuffer<synthLib::SParameterChange, 1024, false> m_pendingParameterChanges;
 	mutable std::recursive_mutex m_mutex;
 	bool m_loadingState = false;
 };
@@ -0,0 +1,210 @@
+#include "presetUpgradeCache.h"
+
+#include <fstream>
+
+#include "../synthLib/hash.h"
+
+#include "dsp56kEmu/logging.h"
+
+namespace virusLib
+{
+	constexpr uint32_t g_cacheFileMagic = 0x43555056;	// 'VPUC'
+	constexpr uint32_t g_cacheFileVersion = 1;
+	constexpr size_t g_maxEntries = 8192;
+
+	PresetUpgradeCache& PresetUpgradeCache::instance()
+	{
+		static PresetUpgradeCache cache;
+		return cache;
+	}
+
+	PresetUpgradeCache::~PresetUpgradeCache()
+	{
+		save();
+	}
+
+	bool PresetUpgradeCache::find(const uint64_t _romHash, const TWords& _preset, TWords& _upgraded) const
+	{
+		std::lock_guard lock(m_mutex);
+
+		const auto it = m_entries.find(createKey(_romHash, _preset));
+
+		if(it == m_entries.end())
+			return false;
+
+		const auto& entry = it->second;
+
+		if(entry.romHash != _romHash || entry.preset != _preset)
+			return false;
+
+		_upgraded = entry.upgraded;
+		return true;
+	}
+
+	void PresetUpgradeCache::add(const uint64_t _romHash, const TWords& _preset, const std::vector<uint8_t>& _upgradedData)
+	{
+		if(_preset.empty() || _upgradedData.empty())
+			return;
+
+		std::lock_guard lock(m_mutex);
+
+		if(m_entries.size() >= g_maxEntries)
+			return;
+
+		const auto key = createKey(_romHash, _preset);
+
+		if(m_entries.find(key) != m_entries.end())
+			return;
+
+		Entry entry;
+		entry.romHash = _romHash;
+		entry.preset = _preset;
+		entry.upgraded.resize((_upgradedData.size() + 2) / 3, 0);
+
+		for(size_t i=0; i<_upgradedData.size(); ++i)
+			entry.upgraded[i / 3] |= static_cast<dsp56k::TWord>(_upgradedData[i]) << ((2 - (i % 3)) << 3);
+
+		m_entries.insert(std::make_pair(key, std::move(entry)));
+		m_dirty = true;
+	}
+
+	bool PresetUpgradeCache::setFilename(const std::string& _filename)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+
+			if(m_filename == _filename)
+				return true;
+
+			m_filename = _filename;
+		}
+
+		// the mutex is used by audio threads, do not hold it while reading the file
+		std::unordered_map<uint64_t, Entry> entries;
+
+		const auto res = load(_filename, entries);
+
+		std::lock_guard lock(m_mutex);
+
+		for (auto& it : entries)
+		{
+			if(m_entries.size() >= g_maxEntries)
+				break;
+			m_entries.insert(std::move(it));
+		}
+
+		return res;
+	}
+
+	bool PresetUpgradeCache::save()
+	{
+		std::string filename;
+		std::vector<Entry> entries;
+
+		{
+			std::lock_guard lock(m_mutex);
+
+			if(!m_dirty || m_filename.empty())
+				return false;
+
+			// the mutex is used by audio threads, copy the entries and write them without holding it
+			filename = m_filename;
+			entries.reserve(m_entries.size());
+
+			for (const auto& it : m_entries)
+				entries.push_back(it.second);
+
+			m_dirty = false;
+		}
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+		if(!file.is_open())
+		{
+			LOG("Failed to write preset upgrade cache to " << filename);
+			std::lock_guard lock(m_mutex);
+			m_dirty = true;
+			return false;
+		}
+
+		auto writeU32 = [&](const uint32_t _v)
+		{
+			file.write(reinterpret_cast<const char*>(&_v), sizeof(_v));
+		};
+
+		auto writeWords = [&](const TWords& _words)
+		{
+			writeU32(static_cast<uint32_t>(_words.size()));
+			file.write(reinterpret_cast<const char*>(_words.data()), static_cast<std::streamsize>(_words.size() * sizeof(dsp56k::TWord)));
+		};
+
+		writeU32(g_cacheFileMagic);
+		writeU32(g_cacheFileVersion);
+		writeU32(static_cast<uint32_t>(entries.size()));
+
+		for (const auto& e : entries)
+		{
+			file.write(reinterpret_cast<const char*>(&e.romHash), sizeof(e.romHash));
+			writeWords(e.preset);
+			writeWords(e.upgraded);
+		}
+
+		return file.good();
+	}
+
+	bool PresetUpgradeCache::load(const std::string& _filename, std::unordered_map<uint64_t, Entry>& _entries)
+	{
+		std::ifstream file(_filename, std::ios::binary);
+
+		if(!file.is_open())
+			return false;
+
+		auto readU32 = [&]()
+		{
+			uint32_t v = 0;
+			file.read(reinterpret_cast<char*>(&v), sizeof(v));
+			return v;
+		};
+
+		auto readWords = [&](TWords& _words)
+		{
+			const auto size = readU32();
+			if(size > 1024)
+				return false;
+			_words.resize(size);
+			file.read(reinterpret_cast<char*>(_words.data()), static_cast<std::streamsize>(size * sizeof(dsp56k::TWord)));
+			return file.good();
+		};
+
+		if(readU32() != g_cacheFileMagic || readU32() != g_cacheFileVersion)
+		{
+			LOG("Ignoring preset upgrade cache " << _filename << ", unknown file format");
+			return false;
+		}
+
+		const auto count = readU32();
+
+		for(uint32_t i=0; i<count && _entries.size() < g_maxEntries; ++i)
+		{
+			Entry e;
+			file.read(reinterpret_cast<char*>(&e.romHash), sizeof(e.romHash));
+
+			if(!readWords(e.preset) || !readWords(e.upgraded))
+			{
+				LOG("Preset upgrade cache " << _filename << " is truncated, read " << i << " of " << count << " entries");
+				return false;
+			}
+
+			const auto key = createKey(e.romHash, e.preset);
+			_entries.insert(std::make_pair(key, std::move(e)));
+		}
+
+		LOG("Loaded " << _entries.size() << " upgraded presets from " << _filename);
+		return true;
+	}
+
+	uint64_t PresetUpgradeCache::createKey(const uint64_t _romHash, const TWords& _preset)
+	{
+		return synthLib::hash(_preset, synthLib::hash(&_romHash, sizeof(_romHash)));
+	}
+}
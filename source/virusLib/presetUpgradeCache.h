@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dsp56kEmu/types.h"
+
+namespace virusLib
+{
+	// Presets of older models are upgraded by the DSP when they are loaded and the result is sent back to us.
+	// The upgraded presets are remembered here, shared by all instances, so that a preset that is loaded
+	// again can be sent in its upgraded form right away
+	class PresetUpgradeCache
+	{
+	public:
+		using TWords = std::vector<dsp56k::TWord>;
+
+		static PresetUpgradeCache& instance();
+
+		bool find(uint64_t _romHash, const TWords& _preset, TWords& _upgraded) const;
+		void add(uint64_t _romHash, const TWords& _preset, const std::vector<uint8_t>& _upgradedData);
+
+		// enables persistence, existing entries are loaded from the given file
+		bool setFilename(const std::string& _filename);
+		bool save();
+
+	private:
+		struct Entry
+		{
+			uint64_t romHash = 0;
+			TWords preset;
+			TWords upgraded;
+		};
+
+		PresetUpgradeCache() = default;
+		~PresetUpgradeCache();
+
+		static bool load(const std::string& _filename, std::unordered_map<uint64_t, Entry>& _entries);
+
+		static uint64_t createKey(uint64_t _romHash, const TWords& _preset);
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		std::string m_filename;
+		bool m_dirty = false;
+	};
+}
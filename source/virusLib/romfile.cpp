@@ -8,6 +8,7 @@
 #include "../dsp56300/source/dsp56kEmu/dsp.h"
 #include "../dsp56300/source/dsp56kEmu/logging.h"
 
+#include "../synthLib/hash.h"
 #include "../synthLib/os.h"
 
 #include <cstring>	// memcpy
@@ -19,6 +20,9 @@
 
 namespace virusLib
 {
+constexpr uint32_t g_singleBanksOffset = 0x50000;
+constexpr uint32_t g_singleBankSize = 0x8000;
+
 void ROMFile::dumpToBin(const std::vector<dsp56k::TWord>& _data, const std::string& _filename)
 {
 	FILE* hFile = fopen(_filename.c_str(), "wb");
@@ -79,6 +83,8 @@ ROMFile::ROMFile(const std::string& _path) : m_file(_path)
 		i = 0;
 	}
 
+	m_hash = synthLib::hash(commandStream, synthLib::hash(bootRom.data));
+
 //	dumpToBin(bootRom.data, _path + "_bootloader.bin");
 //	dumpToBin(commandStream, _path + "_commandstream.bin");
 
@@ -169,9 +175,16 @@ std::thread ROMFile::bootDSP(dsp56k::DSP& dsp, dsp56k::Peripherals56362& periph)
 	return feedCommandStream;
 }
 
+uint32_t ROMFile::getSingleBankCount() const
+{
+	if(m_model != Model::ABC)
+		return 0;
+	return (getRomSizeModelABC() - g_singleBanksOffset) / g_singleBankSize;
+}
+
 bool ROMFile::getSingle(const int _bank, const int _presetNumber, TPreset& _out) const
 {
-	const uint32_t offset = 0x50000 + (_bank * 0x8000) + (_presetNumber * getSinglePresetSize());
+	const uint32_t offset = g_singleBanksOffset + (_bank * g_singleBankSize) + (_presetNumber * getSinglePresetSize());
 
 	return getPreset(offset, _out);
 }
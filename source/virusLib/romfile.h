@@ -59,6 +59,10 @@ public:
 
 	Model getModel() const { return m_model; }
 
+	uint64_t getHash() const { return m_hash; }
+
+	const std::string& getFilename() const { return m_file; }
+
 	uint32_t getSamplerate() const
 	{
 		return 12000000 / 256;
@@ -89,6 +93,9 @@ public:
 		return 128;
 	}
 
+	// number of single banks stored in the ROM
+	uint32_t getSingleBankCount() const;
+
 	static std::string findROM();
 
 	const std::vector<uint8_t>& getDemoData() const { return m_demoData; }
@@ -101,6 +108,7 @@ private:
 
 	const std::string m_file;
 	Model m_model = Model::Invalid;
+	uint64_t m_hash = 0;
 
 	std::vector<TPreset> m_singles;
 	std::vector<TPreset> m_multis;
@@ -0,0 +1,652 @@
+#include "renderServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../synthLib/os.h"
+#include "../synthLib/wavWriter.h"
+
+#ifdef MSG_NOSIGNAL
+constexpr int g_sendFlags = MSG_NOSIGNAL;
+#else
+constexpr int g_sendFlags = 0;
+#endif
+
+namespace
+{
+	// audio is streamed in chunks of this many frames
+	constexpr size_t g_streamChunkFrames = 4096;
+
+	constexpr size_t g_maxLineLength = 1 << 20;
+}
+
+bool RenderServer::Connection::send(const std::string& _line)
+{
+	return send(_line, nullptr, 0);
+}
+
+bool RenderServer::Connection::send(const std::string& _line, const void* _data, const size_t _size)
+{
+	std::lock_guard lock(writeMutex);
+
+	if(closed)
+		return false;
+
+	auto sendAll = [this](const void* _d, size_t _s)
+	{
+		const auto* d = static_cast<const uint8_t*>(_d);
+
+		while(_s > 0)
+		{
+			const auto res = ::send(fd, d, _s, g_sendFlags);
+
+			if(res <= 0)
+			{
+				closed = true;
+				return false;
+			}
+
+			d += res;
+			_s -= static_cast<size_t>(res);
+		}
+		return true;
+	};
+
+	const auto line = _line + '\n';
+
+	if(!sendAll(line.c_str(), line.size()))
+		return false;
+
+	return !_size || sendAll(_data, _size);
+}
+
+RenderServer::RenderServer(Options _options) : m_options(std::move(_options))
+{
+}
+
+RenderServer::~RenderServer()
+{
+	stop();
+}
+
+bool RenderServer::warmUp(const std::string& _romFile, const uint32_t _count)
+{
+	const auto* rom = getRom(_romFile);
+
+	if(!rom)
+		return false;
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<RenderEngine>> engines(_count);
+
+	// boot in parallel, booting is mostly waiting for the DSP
+	for(uint32_t i=0; i<_count; ++i)
+	{
+		threads.emplace_back([&, i]()
+		{
+			engines[i].reset(new RenderEngine(*rom, m_options.engine));
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	for (auto& engine : engines)
+		releaseEngine(std::move(engine));
+
+	std::cout << "Booted " << _count << " devices for ROM " << _romFile << std::endl;
+
+	return true;
+}
+
+bool RenderServer::start()
+{
+	if(m_running)
+		return false;
+
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+
+	if(m_options.socketPath.size() >= sizeof(addr.sun_path))
+	{
+		std::cout << "Socket path " << m_options.socketPath << " is too long" << std::endl;
+		return false;
+	}
+
+	strncpy(addr.sun_path, m_options.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+	m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if(m_listenFd < 0)
+	{
+		std::cout << "Failed to create socket" << std::endl;
+		return false;
+	}
+
+	// remove a stale socket of a previous run
+	unlink(m_options.socketPath.c_str());
+
+	// requests may read and write arbitrary files, only our own user is allowed to connect
+	if(bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || chmod(m_options.socketPath.c_str(), S_IRUSR | S_IWUSR) != 0 || listen(m_listenFd, 16) != 0)
+	{
+		std::cout << "Failed to listen on socket " << m_options.socketPath << ": " << strerror(errno) << std::endl;
+		close(m_listenFd);
+		m_listenFd = -1;
+		return false;
+	}
+
+	m_running = true;
+
+	for(uint32_t i=0; i<std::max(1u, m_options.workerCount); ++i)
+		m_workers.emplace_back([this] { workerThreadFunc(); });
+
+	m_acceptThread = std::thread([this] { acceptThreadFunc(); });
+
+	std::cout << "Listening on " << m_options.socketPath << " with " << m_workers.size() << " workers" << std::endl;
+
+	return true;
+}
+
+void RenderServer::stop()
+{
+	if(!m_running.exchange(false))
+		return;
+
+	shutdown(m_listenFd, SHUT_RDWR);
+	close(m_listenFd);
+	m_listenFd = -1;
+
+	if(m_acceptThread.joinable())
+		m_acceptThread.join();
+
+	{
+		std::lock_guard lock(m_connectionsMutex);
+
+		for (const auto& c : m_connections)
+			shutdown(c->fd, SHUT_RDWR);
+	}
+
+	for (const auto& c : m_connections)
+	{
+		if(c->thread.joinable())
+			c->thread.join();
+	}
+
+	m_requestsCv.notify_all();
+
+	for (auto& w : m_workers)
+		w.join();
+
+	m_workers.clear();
+	m_requests.clear();
+
+	// workers may still send to the connections until they are joined, only now the descriptors can be closed
+	for (const auto& c : m_connections)
+		close(c->fd);
+
+	m_connections.clear();
+
+	unlink(m_options.socketPath.c_str());
+}
+
+void RenderServer::acceptThreadFunc()
+{
+	while(m_running)
+	{
+		const auto fd = accept(m_listenFd, nullptr, nullptr);
+
+		if(fd < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		auto c = std::make_shared<Connection>();
+		c->fd = fd;
+
+		std::lock_guard lock(m_connectionsMutex);
+
+		// clean up connections whose clients do not send requests anymore and that have been answered completely
+		for(auto it = m_connections.begin(); it != m_connections.end();)
+		{
+			auto& existing = *it;
+
+			if(!existing->finished || existing->pendingRequests)
+			{
+				++it;
+				continue;
+			}
+
+			existing->thread.join();
+			close(existing->fd);
+			it = m_connections.erase(it);
+		}
+
+		c->thread = std::thread([this, c] { connectionThreadFunc(c); });
+
+		m_connections.push_back(c);
+	}
+}
+
+void RenderServer::connectionThreadFunc(const std::shared_ptr<Connection>& _connection)
+{
+	std::string buffer;
+	char temp[4096];
+
+	while(m_running)
+	{
+		const auto res = recv(_connection->fd, temp, sizeof(temp), 0);
+
+		if(res <= 0)
+			break;
+
+		buffer.append(temp, static_cast<size_t>(res));
+
+		size_t begin = 0;
+
+		while(true)
+		{
+			const auto end = buffer.find('\n', begin);
+
+			if(end == std::string::npos)
+				break;
+
+			auto line = buffer.substr(begin, end - begin);
+			begin = end + 1;
+
+			if(!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if(line.empty())
+				continue;
+
+			if(line == "ping")
+			{
+				_connection->send("pong");
+				continue;
+			}
+
+			Request request;
+			request.connection = _connection;
+
+			if(!parseRequest(request, line))
+			{
+				_connection->send("error id=" + request.id + ";message=invalid request");
+				continue;
+			}
+
+			if(request.id.empty())
+				request.id = std::to_string(m_nextRequestId++);
+
+			++_connection->pendingRequests;
+
+			{
+				std::lock_guard lock(m_requestsMutex);
+				m_requests.emplace_back(std::move(request));
+			}
+
+			m_requestsCv.notify_one();
+		}
+
+		buffer.erase(0, begin);
+
+		if(buffer.size() > g_maxLineLength)
+		{
+			_connection->send("error id=;message=request too long");
+			break;
+		}
+	}
+
+	// responses to pending requests are still sent, a client might have closed its side of the socket only
+	_connection->finished = true;
+}
+
+void RenderServer::workerThreadFunc()
+{
+	while(true)
+	{
+		Request request;
+
+		{
+			std::unique_lock lock(m_requestsMutex);
+
+			m_requestsCv.wait(lock, [this]
+			{
+				return !m_running || !m_requests.empty();
+			});
+
+			if(!m_running)
+				return;
+
+			request = std::move(m_requests.front());
+			m_requests.pop_front();
+		}
+
+		processRequest(request);
+
+		--request.connection->pendingRequests;
+	}
+}
+
+void RenderServer::processRequest(const Request& _request)
+{
+	// the client is gone, nobody is waiting for the result
+	if(_request.connection->closed)
+		return;
+
+	std::string error;
+
+	try
+	{
+		if(render(_request, error))
+			return;
+	}
+	catch(const std::exception& _e)
+	{
+		error = _e.what();
+	}
+
+	_request.connection->send("error id=" + _request.id + ";message=" + error);
+}
+
+bool RenderServer::render(const Request& _request, std::string& _error)
+{
+	const auto& params = _request.params;
+
+	auto getParam = [&params](const char* _key) -> std::string
+	{
+		const auto it = params.find(_key);
+		return it != params.end() ? it->second : std::string();
+	};
+
+	const auto romFile = params.count("rom") ? getParam("rom") : m_options.defaultRom;
+
+	if(romFile.empty())
+	{
+		_error = "no ROM specified";
+		return false;
+	}
+
+	const auto* rom = getRom(romFile);
+
+	if(!rom)
+	{
+		_error = "failed to load ROM " + romFile;
+		return false;
+	}
+
+	virusLib::ROMFile::TPreset single;
+
+	if(params.count("sysex"))
+	{
+		std::vector<uint8_t> sysex;
+
+		if(!parseHex(sysex, getParam("sysex")) || !RenderEngine::getSingleFromSysex(single, sysex))
+		{
+			_error = "sysex does not contain a single dump";
+			return false;
+		}
+	}
+	else if(params.count("preset"))
+	{
+		const auto preset = getParam("preset");
+
+		const bool found = synthLib::hasExtension(preset, ".syx")
+			? RenderEngine::getSingleFromSysexFile(single, preset)
+			: RenderEngine::findSingle(single, *rom, preset);
+
+		if(!found)
+		{
+			_error = "failed to find preset " + preset;
+			return false;
+		}
+	}
+	else
+	{
+		_error = "either preset or sysex needs to be specified";
+		return false;
+	}
+
+	const auto samplerate = m_options.engine.samplerate;
+
+	std::vector<synthLib::SMidiEvent> events;
+	uint64_t lastSample = 0;
+
+	if(params.count("midi") && !RenderEngine::readMidiFile(events, lastSample, getParam("midi"), samplerate))
+	{
+		_error = "failed to load MIDI file " + getParam("midi");
+		return false;
+	}
+
+	if(params.count("events"))
+	{
+		std::vector<synthLib::SMidiEvent> ev;
+
+		if(!parseEvents(ev, getParam("events")))
+		{
+			_error = "failed to parse events";
+			return false;
+		}
+
+		for (const auto& e : ev)
+			lastSample = std::max<uint64_t>(lastSample, e.offset);
+
+		events.insert(events.end(), ev.begin(), ev.end());
+
+		std::stable_sort(events.begin(), events.end(), [](const synthLib::SMidiEvent& _a, const synthLib::SMidiEvent& _b)
+		{
+			return _a.offset < _b.offset;
+		});
+	}
+
+	const auto seconds = params.count("seconds") ? std::stod(getParam("seconds")) : 0.0;
+
+	const auto sampleCount = seconds > 0.0
+		? static_cast<uint64_t>(seconds * samplerate)
+		: lastSample + static_cast<uint64_t>(m_options.tailSeconds * samplerate);
+
+	const auto outputFile = getParam("out");
+	const bool isFloat = getParam("float") == "1";
+
+	synthLib::WavWriter writer;
+
+	if(!outputFile.empty() && !writer.open(outputFile, isFloat ? 32 : 24, isFloat, 2, static_cast<int>(samplerate)))
+	{
+		_error = "failed to create output file " + outputFile;
+		return false;
+	}
+
+	auto engine = acquireEngine(*rom);
+
+	engine->loadSingle(single);
+
+	auto& connection = *_request.connection;
+
+	std::vector<float> chunk;
+	chunk.reserve(g_streamChunkFrames << 1);
+
+	uint64_t frameCount = 0;
+
+	auto sendChunk = [&]()
+	{
+		if(chunk.empty())
+			return true;
+
+		const auto frames = chunk.size() >> 1;
+		const auto res = connection.send("pcm id=" + _request.id + ";frames=" + std::to_string(frames), &chunk[0], chunk.size() * sizeof(float));
+		chunk.clear();
+		return res;
+	};
+
+	const auto res = engine->render(sampleCount, events, [&](const float* _interleaved, const size_t _frameCount)
+	{
+		frameCount += _frameCount;
+
+		if(writer.isOpen())
+			return writer.writeSamples(_interleaved, _frameCount << 1);
+
+		chunk.insert(chunk.end(), _interleaved, _interleaved + (_frameCount << 1));
+
+		if(chunk.size() < (g_streamChunkFrames << 1))
+			return true;
+
+		return sendChunk();
+	});
+
+	releaseEngine(std::move(engine));
+
+	if(!res || (!writer.isOpen() && !sendChunk()))
+	{
+		_error = writer.isOpen() ? "failed to write to output file " + outputFile : "connection closed";
+		return false;
+	}
+
+	if(writer.isOpen() && !writer.close())
+	{
+		_error = "failed to write to output file " + outputFile;
+		return false;
+	}
+
+	connection.send("done id=" + _request.id + ";frames=" + std::to_string(frameCount));
+
+	return true;
+}
+
+const virusLib::ROMFile* RenderServer::getRom(const std::string& _filename)
+{
+	std::lock_guard lock(m_romsMutex);
+
+	auto& rom = m_roms[_filename];
+
+	if(!rom)
+		rom.reset(new virusLib::ROMFile(_filename));
+
+	return rom->isValid() ? rom.get() : nullptr;
+}
+
+std::unique_ptr<RenderEngine> RenderServer::acquireEngine(const virusLib::ROMFile& _rom)
+{
+	{
+		std::lock_guard lock(m_enginesMutex);
+
+		auto& idle = m_idleEngines[&_rom];
+
+		if(!idle.empty())
+		{
+			auto engine = std::move(idle.back());
+			idle.pop_back();
+			return engine;
+		}
+	}
+
+	// no idle device available, boot a new one. It is added to the pool once the request is finished
+	return std::unique_ptr<RenderEngine>(new RenderEngine(_rom, m_options.engine));
+}
+
+void RenderServer::releaseEngine(std::unique_ptr<RenderEngine> _engine)
+{
+	std::lock_guard lock(m_enginesMutex);
+	m_idleEngines[&_engine->getRom()].emplace_back(std::move(_engine));
+}
+
+bool RenderServer::parseRequest(Request& _request, const std::string& _line)
+{
+	std::stringstream ss(_line);
+	std::string pair;
+
+	while(std::getline(ss, pair, ';'))
+	{
+		if(pair.empty())
+			continue;
+
+		const auto pos = pair.find('=');
+
+		if(pos == std::string::npos || pos == 0)
+			return false;
+
+		_request.params[pair.substr(0, pos)] = pair.substr(pos + 1);
+	}
+
+	const auto it = _request.params.find("id");
+
+	if(it != _request.params.end())
+		_request.id = it->second;
+
+	return !_request.params.empty();
+}
+
+bool RenderServer::parseEvents(std::vector<synthLib::SMidiEvent>& _events, const std::string& _text)
+{
+	std::stringstream ss(_text);
+	std::string ev;
+
+	while(std::getline(ss, ev, ','))
+	{
+		const auto pos = ev.find(':');
+
+		if(pos == std::string::npos)
+			return false;
+
+		std::vector<uint8_t> data;
+
+		if(!parseHex(data, ev.substr(pos + 1)) || data.empty())
+			return false;
+
+		synthLib::SMidiEvent e;
+		e.offset = static_cast<uint32_t>(std::stoul(ev.substr(0, pos)));
+
+		if(data.front() == synthLib::M_STARTOFSYSEX)
+		{
+			e.sysex = std::move(data);
+		}
+		else
+		{
+			e.a = data[0];
+			e.b = data.size() > 1 ? data[1] : 0;
+			e.c = data.size() > 2 ? data[2] : 0;
+		}
+
+		_events.emplace_back(std::move(e));
+	}
+
+	return true;
+}
+
+bool RenderServer::parseHex(std::vector<uint8_t>& _data, const std::string& _hex)
+{
+	auto nibble = [](const char _c) -> int
+	{
+		if(_c >= '0' && _c <= '9')	return _c - '0';
+		if(_c >= 'a' && _c <= 'f')	return _c - 'a' + 10;
+		if(_c >= 'A' && _c <= 'F')	return _c - 'A' + 10;
+		return -1;
+	};
+
+	if(_hex.size() & 1)
+		return false;
+
+	_data.reserve(_data.size() + (_hex.size() >> 1));
+
+	for(size_t i=0; i<_hex.size(); i += 2)
+	{
+		const auto hi = nibble(_hex[i]);
+		const auto lo = nibble(_hex[i+1]);
+
+		if(hi < 0 || lo < 0)
+			return false;
+
+		_data.push_back(static_cast<uint8_t>(hi << 4 | lo));
+	}
+	return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../virusConsoleLib/renderEngine.h"
+
+// Long running render service that keeps booted devices per ROM. Clients connect via a UNIX domain socket and send
+// requests, one per line, as key=value pairs separated by ';':
+//
+//   id        id that is sent back with every response of the request
+//   rom       ROM file, optional if the server has a default ROM
+//   preset    preset name, preset number or .syx file
+//   sysex     single dump as hex string, alternative to preset
+//   midi      MIDI file
+//   events    MIDI events as comma separated list of sample:hexbytes, for example 0:903c64,48000:803c00
+//   seconds   length, if omitted the length of the MIDI events plus the tail length is used
+//   out       output wave file. If omitted, the audio is streamed back
+//   float     1 to write 32 bit float instead of 24 bit integer wave files
+//
+// Responses are sent as soon as they are available and are not necessarily in request order:
+//
+//   pcm id=<id>;frames=<n>      followed by n stereo frames of 32 bit float little endian data
+//   done id=<id>;frames=<n>     render finished, the audio was streamed or written to the output file
+//   error id=<id>;message=<m>   render failed
+//
+// A line containing "ping" is answered with "pong"
+//
+// File paths in requests are trusted, they are read and written with the permissions of the server. The socket is
+// therefore only accessible by the user that runs the server
+class RenderServer
+{
+public:
+	struct Options
+	{
+		std::string socketPath = "/tmp/virusRenderServer.sock";
+		std::string defaultRom;
+		uint32_t workerCount = 4;
+		float tailSeconds = 2.0f;
+		RenderEngine::Options engine;
+	};
+
+	explicit RenderServer(Options _options);
+	~RenderServer();
+
+	// boots devices in advance so that the first requests do not have to wait for it
+	bool warmUp(const std::string& _romFile, uint32_t _count);
+
+	bool start();
+	void stop();
+
+private:
+	struct Connection
+	{
+		int fd = -1;
+		std::mutex writeMutex;
+		std::atomic<bool> closed = false;		// writing failed, the client is gone
+		std::atomic<bool> finished = false;		// the client does not send any more requests
+		std::atomic<uint32_t> pendingRequests = 0;
+		std::thread thread;
+
+		bool send(const std::string& _line);
+		bool send(const std::string& _line, const void* _data, size_t _size);
+	};
+
+	struct Request
+	{
+		std::shared_ptr<Connection> connection;
+		std::string id;
+		std::map<std::string, std::string> params;
+	};
+
+	void acceptThreadFunc();
+	void connectionThreadFunc(const std::shared_ptr<Connection>& _connection);
+	void workerThreadFunc();
+
+	void processRequest(const Request& _request);
+	bool render(const Request& _request, std::string& _error);
+
+	const virusLib::ROMFile* getRom(const std::string& _filename);
+	std::unique_ptr<RenderEngine> acquireEngine(const virusLib::ROMFile& _rom);
+	void releaseEngine(std::unique_ptr<RenderEngine> _engine);
+
+	static bool parseRequest(Request& _request, const std::string& _line);
+	static bool parseEvents(std::vector<synthLib::SMidiEvent>& _events, const std::string& _text);
+	static bool parseHex(std::vector<uint8_t>& _data, const std::string& _hex);
+
+	const Options m_options;
+
+	int m_listenFd = -1;
+	std::atomic<bool> m_running = false;
+	std::thread m_acceptThread;
+
+	std::mutex m_connectionsMutex;
+	std::list<std::shared_ptr<Connection>> m_connections;
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_requestsMutex;
+	std::condition_variable m_requestsCv;
+	std::deque<Request> m_requests;
+
+	std::mutex m_romsMutex;
+	std::map<std::string, std::unique_ptr<virusLib::ROMFile>> m_roms;
+
+	std::mutex m_enginesMutex;
+	std::map<const virusLib::ROMFile*, std::vector<std::unique_ptr<RenderEngine>>> m_idleEngines;
+
+	std::atomic<uint64_t> m_nextRequestId = 0;
+};
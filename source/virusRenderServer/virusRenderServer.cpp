@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "renderServer.h"
+
+#include "../dsp56300/source/disassemble/commandline.h"
+
+namespace
+{
+	std::atomic<bool> g_quit = false;
+
+	void signalHandler(int)
+	{
+		g_quit = true;
+	}
+
+	void printUsage()
+	{
+		std::cout << "Usage: virusRenderServer [-socket path] [-rom file.bin] [-warm n] [-workers n] [-samplerate n] [-blocksize n] [-preroll seconds] [-tail seconds]" << std::endl;
+		std::cout << "  -rom       default ROM for requests that do not specify one" << std::endl;
+		std::cout << "  -warm      number of devices that are booted for the default ROM at startup" << std::endl;
+	}
+}
+
+int main(int _argc, char* _argv[])
+{
+	try
+	{
+		const CommandLine cmd(_argc, _argv);
+
+		if(cmd.contains("help"))
+		{
+			printUsage();
+			return 0;
+		}
+
+		RenderServer::Options options;
+
+		if(cmd.contains("socket"))		options.socketPath = cmd.get("socket");
+		if(cmd.contains("rom"))			options.defaultRom = cmd.get("rom");
+		if(cmd.contains("workers"))		options.workerCount = static_cast<uint32_t>(std::max(1, cmd.getInt("workers")));
+		if(cmd.contains("tail"))		options.tailSeconds = std::stof(cmd.get("tail"));
+		if(cmd.contains("samplerate"))	options.engine.samplerate = std::stof(cmd.get("samplerate"));
+		if(cmd.contains("blocksize"))	options.engine.blockSize = static_cast<uint32_t>(std::max(1, cmd.getInt("blocksize")));
+		if(cmd.contains("preroll"))		options.engine.prerollSeconds = std::stof(cmd.get("preroll"));
+
+		const auto warmCount = static_cast<uint32_t>(cmd.contains("warm") ? std::max(0, cmd.getInt("warm")) : static_cast<int>(options.workerCount));
+
+		RenderServer server(options);
+
+		if(!options.defaultRom.empty() && warmCount && !server.warmUp(options.defaultRom, warmCount))
+		{
+			std::cout << "ROM file " << options.defaultRom << " couldn't be loaded. Make sure that the ROM file is valid" << std::endl;
+			return -1;
+		}
+
+		signal(SIGPIPE, SIG_IGN);
+		signal(SIGINT, signalHandler);
+		signal(SIGTERM, signalHandler);
+
+		if(!server.start())
+			return -1;
+
+		while(!g_quit)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+		std::cout << "Shutting down" << std::endl;
+
+		server.stop();
+
+		return 0;
+	}
+	catch(const std::runtime_error& _err)
+	{
+		std::cout << _err.what() << std::endl;
+		return -1;
+	}
+	catch(const std::logic_error& _err)
+	{
+		std::cout << "Invalid command line argument: " << _err.what() << std::endl;
+		return -1;
+	}
+}
@@ -49,9 +49,18 @@ int main(int _argc, char* _argv[])
 		return -1;
 	}
 
-	if(_argc > 1)
+	// the preset or demo is the first argument that is not an option, options may be given before or after it
+	int nameArg = 0;
+
+	for(int i=1; i<_argc && !nameArg; ++i)
 	{
-		const std::string name = _argv[1];
+		if(_argv[i][0] != '-')
+			nameArg = i;
+	}
+
+	if(nameArg)
+	{
+		const std::string name = _argv[nameArg];
 		if(hasExtension(name, ".mid") || hasExtension(name, ".bin"))
 		{
 			if(!app->loadDemo(name))
@@ -72,7 +81,7 @@ int main(int _argc, char* _argv[])
 		}
 		else if(!app->loadSingle(name))
 		{
-			std::cout << "Failed to find preset '" << _argv[1] << "', make sure to use a ROM that contains it" << std::endl;
+			std::cout << "Failed to find preset '" << name << "', make sure to use a ROM that contains it" << std::endl;
 			ConsoleApp::waitReturn();
 			return -1;
 		}
@@ -83,9 +92,28 @@ int main(int _argc, char* _argv[])
 			app->loadSingle(0, 0);
 	}
 
+	AudioOutputOptions outputOptions;
+
+	for(int i=1; i<_argc; ++i)
+	{
+		if(i == nameArg)
+			continue;
+
+		const std::string arg = _argv[i];
+
+		if(arg == "-stems")
+			outputOptions.mode = AudioOutputOptions::Mode::Stems;
+		else if(arg == "-multichannel")
+			outputOptions.mode = AudioOutputOptions::Mode::MultiChannel;
+		else if(arg == "-float")
+			outputOptions.isFloat = true;
+		else
+			std::cout << "Ignoring unknown argument " << arg << std::endl;
+	}
+
 	const std::string audioFilename = app->getSingleNameAsFilename();
 
-	app->run(audioFilename);
+	app->run(audioFilename, 0, false, outputOptions);
 
 	std::cout << "Program ended. Press key to exit." << std::endl;
 	ConsoleApp::waitReturn();